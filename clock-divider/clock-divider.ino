@@ -7,8 +7,9 @@ const int CLOCK_LED = 1; // LED pin for input signal indication
 const int CLOCK_INPUT = 2; // Input signal pin, must be usable for interrupts
 const int RESET_INPUT = 3; // Reset signal pin, must be usable for interrupts
 const int RESET_BUTTON = 4; // Reset button pin
+const int RANDOM_SEED_INPUT = A6; // Unconnected analog input, whose noise seeds the probabilities
 
-const int DIVISIONS[] { 2, 3, 4, 5, 6, 8, 16, 32 }; // Integer divisions of the input clock (max 32 values)
+const int DIVISIONS[] { 2, 3, 4, 5, 6, 8, 16, 32 }; // Integer divisions of the input clock (max 32 values, the clock LED is disabled with 32), negative for multiplications
 const int DIVISIONS_OUTPUT[] { 5, 6, 7, 8, 9, 10, 11, 12 }; // Output pins
 const int DIVISIONS_LEDS[] { 0, A5, A4, A3, A2, A1, A0, 13 }; // LEDs pins
 
@@ -16,17 +17,43 @@ const unsigned long MODE_SWITCH_LONG_PRESS_DURATION_MS = 3000; // Reset button l
 const unsigned long BUTTON_DEBOUNCE_DELAY = 50; // Debounce delay for all buttons
 const unsigned long LED_MIN_DURATION_MS = 50; // Minimum "on" duration for all LEDs visibility
 
+// TRUE to use the module as a frequency divider on audio-rate inputs (sub-octave generator).
+// Use it in gate mode to get square waves. Output LEDs and debugging are disabled to keep clock edges processing fast.
+const bool HIGH_RATE = false;
+
+// Swing and ratchets of each output, scheduled from a timer on the input clock period (not available in high-rate mode).
+// Swing delays every other pulse by a percentage of the divided period (0 to 50), ratchets split each pulse into
+// a number of shorter pulses (1 for none), evenly spaced in what remains of the divided period.
+const byte SWING[] { 0, 0, 0, 0, 0, 0, 0, 0 };
+const byte RATCHETS[] { 1, 1, 1, 1, 1, 1, 1, 1 };
+const unsigned long SCHEDULER_TICK_US = 100; // Resolution of swung, ratcheted and multiplied pulses
+const unsigned long CLOCK_MIN_PERIOD_US = 1000; // Shorter input clock periods are rejected as bounces when measured
+
+// Probability and logic of each output. Each pulse fires with a probability in percent, and logic outputs combine
+// the divisions of two other outputs (numbered from 0) instead of following their own: '&' for AND, '|' for OR,
+// '^' for XOR, e.g. { '^', 0, 1 } (0 for a plain division). Both are ignored on multiplied outputs and in high-rate mode.
+const byte PROBABILITY[] { 100, 100, 100, 100, 100, 100, 100, 100 };
+const char LOGIC[][3] {
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+};
+
 const bool EUCLIDEAN = false; // TRUE to enable 8 channels of Euclidean rhythms
-const int EUCLIDEAN_N_STEPS = 8;  
-const int EUCLIDEAN_RHYTHMS[][EUCLIDEAN_N_STEPS] {
-	{ 1, 0, 0, 0, 0, 0, 0, 0 },
-	{ 1, 0, 0, 0, 1, 0, 0, 0 },
-	{ 1, 0, 0, 1, 0, 0, 1, 0 },
-	{ 1, 0, 1, 0, 1, 0, 1, 0 },
-	{ 0, 1, 1, 0, 1, 1, 0, 1 },
-	{ 0, 1, 1, 1, 0, 1, 1, 1 },
-	{ 0, 1, 1, 1, 1, 1, 1, 1 },
-	{ 1, 1, 1, 1, 1, 1, 1, 1 },
+const byte EUCLIDEAN_RHYTHMS[][3] { // Steps (up to 32), pulses (up to the steps) and rotation to the left of each channel
+	{ 8, 1, 0 },
+	{ 8, 2, 0 },
+	{ 8, 3, 0 },
+	{ 8, 4, 0 },
+	{ 8, 5, 3 },
+	{ 8, 6, 1 },
+	{ 8, 7, 1 },
+	{ 8, 8, 0 },
 };
 
 // ===========================================================================
@@ -34,20 +61,78 @@ const int EUCLIDEAN_RHYTHMS[][EUCLIDEAN_N_STEPS] {
 #include <EEPROM.h>
 
 #include "lib/Button.cpp"
-#include "lib/Led.cpp"
+#include "lib/EdgeQueue.cpp"
+#include "lib/FastPin.cpp"
+#include "lib/FastRandom.cpp"
+#define LED_BANK_SIZE 32 // An LED for each output, and one for the clock if there are less than 32 outputs
+#include "lib/LedBank.cpp"
+#include "lib/PeriodEstimator.cpp"
+#include "lib/PeriodicTimer.cpp"
+
+#include "pulse_queue.cpp"
 
 unsigned int n = 0; // Number of divisions
-long count = -1; // Input clock counter, -1 in order to go to 0 no the first pulse
-bool gateMode = false; // TRUE if gate mode is active, FALSE if standard trig mode is active
+volatile bool gateMode = false; // TRUE if gate mode is active, FALSE if standard trig mode is active
 
-Led clockLed; // Input LED
-Led leds[32]; // Output LEDs
+byte clockLed; // Input LED, index in the LedBank (output LEDs come first, with the same index of their output)
 Button resetButton;
 
-volatile bool clock = false; // Clock signal digital reading, set in the clock ISR
-volatile bool clockFlag = false; // Clock signal change flag, set in the clock ISR
+EdgeQueue clockEdges; // Clock signal changes (digital reading and time), filled in the clock ISR
 volatile bool resetFlag = false; // Reset flag, set in the reset ISR
 
+// Outputs are computed in the clock ISR and written to their ports at once, aligned with the input edge.
+// Each division has its own counter, so that no division or modulo is needed while running.
+byte divisionCounter[32]; // Input clock counter for each division (or Euclidean step), the division fires when it's zero
+byte divisionLength[32]; // Counter length, i.e. the division (or the number of Euclidean steps)
+byte divisionHalf[32]; // Counter value for the gate to go low, i.e. half of the division
+unsigned long divisionOddMask = 0; // Odd divisions, for which the gate goes low on a falling edge
+unsigned long euclideanPattern[32]; // Euclidean pattern of each output, bit i is for step i
+const byte BIT_MASKS[8] { 1, 2, 4, 8, 16, 32, 64, 128 }; // Avoids variable shifts, which are loops on AVR
+
+// Probability and logic are compiled into a small program for each output, evaluated in the clock ISR over the
+// bit mask of fired divisions, so that logic outputs cost about the same as plain divisions
+struct OutputProgram {
+	char op; // Logic operation, zero for a plain division
+	byte a; // First (or only) division
+	byte b; // Second division
+	byte threshold; // Fire if a random byte is below this, always if 255
+};
+OutputProgram outputPrograms[32];
+unsigned long logicMask = 0; // Logic outputs
+FastRandom probabilityRandom;
+volatile unsigned long isrClockMaxTime = 0; // Longest clock ISR run, for debugging
+byte outputPort[32]; // Port of each output, as an index for the arrays below (0 for port B, 1 for C, 2 for D)
+byte outputBit[32]; // Bit mask of each output in its port
+volatile uint8_t* outputPortRegister[3]; // Output register of each port
+byte outputPortMask[3]; // Bit mask of all the outputs on each port
+volatile unsigned long outputsState = 0; // Current outputs, bit i is for output i
+volatile unsigned long outputsRose = 0; // Outputs that went high since the LEDs have been updated
+unsigned long ledsState = 0; // Outputs currently displayed on LEDs
+
+// Swung and ratcheted outputs are started in the clock ISR and continued from the pulse queue in the timer ISR
+PeriodEstimator clockPeriod; // Input clock period, measured in the clock ISR
+unsigned long clockRiseTime = 0; // Time of the last input rising edge
+unsigned long clockWidth = 0; // Duration of the last input pulse, copied by swung and ratcheted triggers
+PulseQueue pulses; // Next edge of each swung or ratcheted output
+unsigned long scheduledMask = 0; // Outputs with swing or ratchets
+unsigned long swingOffbeatMask = 0; // Outputs whose next pulse is an off-beat, to be delayed by swing
+byte pulsesLeft[32]; // Pulses left in the current ratchet of each output
+unsigned long pulseSpacing[32]; // Time between the pulses of the current ratchet of each output
+volatile unsigned long pulsesPeriod = 0; // Input period the swing delays and ratchet spacings were computed on, zero before
+unsigned long swingDelay[32]; // Delay of the off-beat pulses of each output
+unsigned long ratchetSpacing[2][32]; // Time between the ratchet pulses of each output, on and off the beat
+
+// Multiplied outputs follow a phase accumulator advanced by the timer ISR and locked to input rising edges (PLL).
+// The phase is a fraction of the input period in 32 bits, so that the phase of a multiplication by m is simply phase * m.
+const unsigned long PLL_HALF = 0x80000000UL; // Half period, in phase units
+unsigned long multipliedMask = 0; // Outputs with multiplications
+unsigned long clockInterval = 0; // Duration of the last input period
+unsigned long pllInterval = 0; // Input period the phase increments were computed on
+unsigned long pllPhase = 0; // Current phase of the input period
+unsigned long pllPhasePerUs = 0; // Phase increment for each microsecond, zero until the input period is known
+unsigned long pllIncrement = 0; // Phase increment for each timer tick
+unsigned long pllWidth = 0; // Duration of the last input pulse, in phase units, copied by multiplied triggers
+
 const int MODE_EEPROM_ADDRESS = 0;
 
 void setup() {
@@ -65,21 +150,87 @@ void setup() {
 	resetButton.init(RESET_BUTTON, BUTTON_DEBOUNCE_DELAY);
 	
 	// Setup outputs (divisions and LEDs)
-	clockLed.init(CLOCK_LED, LED_MIN_DURATION_MS);
 	for (int i = 0; i < n; i++) {
-		leds[i].init(DIVISIONS_LEDS[i], LED_MIN_DURATION_MS);
+		LedBank::add(DIVISIONS_LEDS[i], LED_MIN_DURATION_MS);
 		pinMode(DIVISIONS_OUTPUT[i], OUTPUT);
 		digitalWrite(DIVISIONS_OUTPUT[i], LOW);
 	}
+	clockLed = LedBank::add(CLOCK_LED, LED_MIN_DURATION_MS);
+	
+	// Precompute divisions counters, Euclidean patterns and output ports
+	for (int i = 0; i < n; i++) {
+		if (!EUCLIDEAN && DIVISIONS[i] < 0) {
+			divisionLength[i] = 1; // Multiplication, same as dividing by one until the input period is known
+			multipliedMask |= 1UL << i;
+		} else if (!EUCLIDEAN) {
+			divisionLength[i] = DIVISIONS[i];
+		} else if (i < sizeof(EUCLIDEAN_RHYTHMS) / sizeof(EUCLIDEAN_RHYTHMS[0])) {
+			divisionLength[i] = constrain(EUCLIDEAN_RHYTHMS[i][0], 1, 32);
+			euclideanPattern[i] = euclideanGenerate(divisionLength[i], EUCLIDEAN_RHYTHMS[i][1], EUCLIDEAN_RHYTHMS[i][2]);
+		} else {
+			divisionLength[i] = 1; // No pattern for this output, always silent
+			euclideanPattern[i] = 0;
+		}
+		divisionCounter[i] = divisionLength[i] - 1; // The first pulse goes to zero
+		divisionHalf[i] = divisionLength[i] / 2;
+		if (divisionLength[i] % 2 != 0) divisionOddMask |= 1UL << i;
+		byte port = digitalPinToPort(DIVISIONS_OUTPUT[i]);
+		outputPort[i] = port - PB;
+		outputBit[i] = digitalPinToBitMask(DIVISIONS_OUTPUT[i]);
+		outputPortRegister[port - PB] = portOutputRegister(port);
+		outputPortMask[port - PB] |= outputBit[i];
+	}
+	// Compile probability and logic programs
+	for (int i = 0; i < n; i++) {
+		OutputProgram& program = outputPrograms[i];
+		program.op = 0;
+		program.a = i;
+		program.b = i;
+		if (!HIGH_RATE && LOGIC[i][0] != 0 && !bitRead(multipliedMask, i)) {
+			program.op = LOGIC[i][0];
+			program.a = LOGIC[i][1] & 31;
+			program.b = LOGIC[i][2] & 31;
+			logicMask |= 1UL << i;
+		}
+		program.threshold = PROBABILITY[i] >= 100 || bitRead(multipliedMask, i) ? 255 : PROBABILITY[i] * 255 / 100;
+	}
+	probabilityRandom.init(FastRandom::entropy(RANDOM_SEED_INPUT)); // Watchdog jitter and input noise
+	
+	// Swing and ratchets pulse queue and multiplications PLL, ticking only if used
+	for (int i = 0; i < n; i++) {
+		if ((SWING[i] > 0 || RATCHETS[i] > 1) && !bitRead(multipliedMask, i)) scheduledMask |= 1UL << i;
+	}
+	clockPeriod.init(CLOCK_MIN_PERIOD_US);
+	pulses.init();
+	if (!HIGH_RATE && (scheduledMask | multipliedMask) != 0) {
+		PeriodicTimer::init(isrTick);
+		PeriodicTimer::start(SCHEDULER_TICK_US);
+	}
 	
 	// Interrupts
-	pinMode(CLOCK_INPUT, INPUT);
-	pinMode(RESET_INPUT, INPUT);
+	clockEdges.init();
+	FastPin<CLOCK_INPUT>::input();
+	FastPin<RESET_INPUT>::input();
 	attachInterrupt(digitalPinToInterrupt(CLOCK_INPUT), isrClock, CHANGE);
 	attachInterrupt(digitalPinToInterrupt(RESET_INPUT), isrReset, RISING);
 	
 }
 
+/**
+ * Distribute the given number of pulses as evenly as possible over the steps, like Bjorklund's algorithm,
+ * with Bresenham's line algorithm: a step has a pulse when the accumulated pulses wrap around the steps.
+ * The pattern is rotated to the left by the given number of steps, and packed as a bit mask.
+ * There can't be more pulses than steps, which also keeps the products below within 16 bits.
+ */
+unsigned long euclideanGenerate(byte steps, byte pulses, byte rotation) {
+	pulses = min(pulses, steps);
+	unsigned long pattern = 0;
+	for (byte i = 0; i < steps; i++) {
+		if (((unsigned int)(i + rotation) * pulses) % steps < pulses) pattern |= 1UL << i;
+	}
+	return pattern;
+}
+
 void loop() {
 	
 	// Read manual reset button and set the flag
@@ -88,129 +239,361 @@ void loop() {
 			resetFlag = true;
 		}
 	}
+	
+	if (!HIGH_RATE) loopLeds();
+	if (!HIGH_RATE && scheduledMask != 0) loopPulses();
+	if (!HIGH_RATE && multipliedMask != 0) loopPll();
+	
+	// Mode switch
+	if (resetButton.readLongPressOnce(MODE_SWITCH_LONG_PRESS_DURATION_MS)) {
+		gateMode = !gateMode;
+		EEPROM.update(MODE_EEPROM_ADDRESS, gateMode ? 1 : 0); // Mode selection on permanent storage
+	}
+	
+}
 
-	// Clock signal changed
-	if (clockFlag) {
-		clockFlag = false;
+void loopLeds() {
+	
+	// Input LED, for every edge even if the loop was busy for a while
+	unsigned long clockTime;
+	byte clock;
+	while (clockEdges.pop(clockTime, clock)) {
 		
 		if (DEBUG) {
 			Serial.print("Clock signal changed: ");
-			Serial.println(clock);
+			Serial.print(clock);
+			Serial.print(" at ");
+			Serial.print(clockTime);
+			Serial.print(" us, lost edges: ");
+			Serial.print(clockEdges.getOverflows());
+			Serial.print(", longest ISR: ");
+			noInterrupts();
+			unsigned long isrTime = isrClockMaxTime;
+			interrupts();
+			Serial.print(isrTime);
+			Serial.println(" us");
 		}
 		
-		// Input LED
-		clockLed.set(clock);
+		LedBank::set(clockLed, clock);
 		
-		if (clock) {
-			
-			// Clock rising, update counter
-			if (resetFlag) {
-				resetFlag = false;
-				count = 0;
-			} else {
-				count++;
-			}
-			
-			if (DEBUG) {
-				Serial.print("Counter changed: ");
-				Serial.println(count);
-			}
-			
-		}
+	}
+	
+	// Output LEDs, flashing also those that went high and low again in the meanwhile
+	noInterrupts();
+	unsigned long outputs = outputsState;
+	unsigned long rose = outputsRose;
+	outputsRose = 0;
+	interrupts();
+	if (rose != 0 || outputs != ledsState) {
+		ledsState = outputs;
+		LedBank::flashMask(rose);
+		LedBank::setMask(n < 32 ? (1UL << n) - 1 : 0xFFFFFFFFUL, outputs);
 		
-		// Update outputs according to current trig/gate mode
-		if (gateMode) {
-			processGateMode();
-		} else {
-			processTriggerMode();
+		if (DEBUG) {
+			Serial.print("Outputs changed: ");
+			Serial.println(outputs, BIN);
 		}
 		
 	}
 	
-	// Mode switch
-	if (resetButton.readLongPressOnce(MODE_SWITCH_LONG_PRESS_DURATION_MS)) {
-		gateMode = !gateMode;
-		EEPROM.update(MODE_EEPROM_ADDRESS, gateMode ? 1 : 0); // Mode selection on permanent storage
+	// Update LEDs
+	LedBank::loop();
+	
+}
+
+/**
+ * Compute swing delays and ratchet spacings again when the input period changes, here rather than in the clock ISR,
+ * where the divisions would delay the outputs. Each output is published with interrupts disabled.
+ */
+void loopPulses() {
+	noInterrupts();
+	unsigned long period = clockPeriod.get();
+	interrupts();
+	if (period == 0 || period == pulsesPeriod) return;
+	
+	for (byte i = 0; i < n; i++) {
+		if (!bitRead(scheduledMask, i)) continue;
+		unsigned long divided = !EUCLIDEAN ? period * DIVISIONS[i] : period;
+		unsigned long delay = divided / 100 * min(SWING[i], 50);
+		byte ratchets = max(RATCHETS[i], 1);
+		unsigned long onbeat = divided / ratchets;
+		unsigned long offbeat = (divided - delay) / ratchets;
+		noInterrupts();
+		swingDelay[i] = delay;
+		ratchetSpacing[0][i] = onbeat;
+		ratchetSpacing[1][i] = offbeat;
+		interrupts();
 	}
+	pulsesPeriod = period;
 	
-	// Update LEDs
-	clockLed.loop();
-	for (int i = 0; i < n; i++) leds[i].loop();
+}
+
+/**
+ * Compute the phase increments of the PLL again when the input period changes, here rather than in the clock ISR.
+ * Until then the phase follows the previous period, so it's set again from the time elapsed since the input edge.
+ */
+void loopPll() {
+	noInterrupts();
+	unsigned long interval = clockInterval;
+	interrupts();
+	if (interval == 0 || interval == pllInterval) return;
+	
+	unsigned long phasePerUs = 0xFFFFFFFFUL / interval;
+	noInterrupts();
+	if (clockInterval == interval) { // Not changed by an edge in the meanwhile
+		unsigned long elapsed = micros() - clockRiseTime;
+		pllPhasePerUs = phasePerUs;
+		pllIncrement = phasePerUs * SCHEDULER_TICK_US;
+		pllPhase = elapsed < interval ? phasePerUs * elapsed : 0xFFFFFFFFUL;
+		pllInterval = interval;
+	}
+	interrupts();
 	
 }
 
-void processTriggerMode() {
+void isrClock() {
 	
-	// Copy input signal on current divisions
+	bool clock = FastPin<CLOCK_INPUT>::read(); // A single instruction, the pin is known at compile time
+	unsigned long now = !HIGH_RATE ? micros() : 0;
+	
+	// Clock rising, update counters (down-beat on reset)
+	bool reset = false;
 	if (clock) {
-		
-		// Rising edge, go HIGH on current divisions (or advance Euclidean patterns)
-		for (int i = 0; i < n; i++) {
-			bool v;
+		reset = resetFlag;
+		resetFlag = false;
+		for (byte i = 0; i < n; i++) {
+			if (reset || ++divisionCounter[i] == divisionLength[i]) divisionCounter[i] = 0;
+		}
+	}
+	
+	// Measure the input clock for swung, ratcheted and multiplied outputs
+	if (!HIGH_RATE && (scheduledMask | multipliedMask) != 0) {
+		if (clock) {
+			
+			// Lock the PLL on every rising edge, to the last period only to follow tempo changes at once
+			// (the main loop computes the new phase increments)
+			unsigned long interval = now - clockPeriod.getLastUs();
+			if (clockPeriod.update(now) && clockPeriod.get() != 0) {
+				clockInterval = interval;
+				pllPhase = 0;
+			}
+			clockRiseTime = now;
+			if (reset) swingOffbeatMask = 0;
+			
+		} else {
+			clockWidth = now - clockRiseTime;
+			pllWidth = clockWidth < clockInterval / 2 ? pllPhasePerUs * clockWidth : PLL_HALF;
+		}
+	}
+	
+	// Divisions (or Euclidean patterns) that fire on this rising edge
+	unsigned long fired = 0;
+	unsigned long bit = 1;
+	if (clock) {
+		for (byte i = 0; i < n; i++, bit <<= 1) {
+			bool fire;
 			if (!EUCLIDEAN) {
-				v = (count % DIVISIONS[i] == 0);
+				fire = divisionCounter[i] == 0;
 			} else {
-				int step = count % EUCLIDEAN_N_STEPS;
-				v = EUCLIDEAN_RHYTHMS[i][step] == 1;
+				byte step = divisionCounter[i];
+				fire = (((byte*)&euclideanPattern[i])[step >> 3] & BIT_MASKS[step & 7]) != 0; // Test the step bit in its byte
 			}
-			digitalWrite(DIVISIONS_OUTPUT[i], v ? HIGH : LOW);
-			leds[i].set(v);
+			if (fire) fired |= bit;
 		}
+	}
+	
+	// Update outputs according to current trig/gate mode, collecting bits to be set and cleared on each port
+	byte portHigh[3] { 0, 0, 0 };
+	byte portLow[3] { 0, 0, 0 };
+	unsigned long outputs = outputsState;
+	byte* firedBytes = (byte*)&fired;
+	bit = 1;
+	for (byte i = 0; i < n; i++, bit <<= 1) {
 		
-	} else {
+		// Go HIGH on the rising edges that corresponds to the division (or Euclidean pattern), or to the logic
+		// combination of two divisions, unless skipped by probability
+		bool fire;
+		if (!HIGH_RATE) {
+			OutputProgram& program = outputPrograms[i];
+			bool a = (firedBytes[program.a >> 3] & BIT_MASKS[program.a & 7]) != 0;
+			bool b = (firedBytes[program.b >> 3] & BIT_MASKS[program.b & 7]) != 0;
+			switch (program.op) {
+				case '&': fire = a && b; break;
+				case '|': fire = a || b; break;
+				case '^': fire = a != b; break;
+				default: fire = a;
+			}
+			if (fire && program.threshold != 255) fire = (byte)(probabilityRandom.next() >> 24) < program.threshold; // Upper byte, the most random
+		} else {
+			fire = (fired & bit) != 0;
+		}
+		bool high = clock && fire;
+		
+		bool low;
+		if (!HIGH_RATE && (multipliedMask & bit) != 0 && pllPhasePerUs != 0) {
+			
+			// Multiplication: the first pulse starts with the input one, then the timer ISR follows the PLL phase
+			low = false;
+			
+		} else if (!HIGH_RATE && (scheduledMask & bit) != 0 && pulsesPeriod != 0) {
+			
+			// Swing or ratchets: start the pulses, then the pulse queue takes over (cut them short on reset)
+			low = reset;
+			if (reset) pulses.cancel(i);
+			if (high) high = pulseStart(i, bit, now);
+			
+		} else if (!gateMode) {
+			
+			// Trigger mode: copy input signal on current divisions, go LOW on every output on falling edges
+			low = !high;
+			
+		} else if (!EUCLIDEAN && (logicMask & bit) == 0) {
+			
+			// Gate mode, keep outputs high for ~50% of divided time: go LOW on rising edges for even divisions
+			// and falling edges for odd divisions, considering the edges that corresponds to the half value of the division
+			bool divisionIsOdd = (divisionOddMask & bit) != 0;
+			low = divisionCounter[i] == divisionHalf[i] && clock != divisionIsOdd;
+			
+		} else {
+			
+			// Gate mode for Euclidean and logic outputs: go LOW on the next rising edge that doesn't fire
+			low = clock && !fire;
+			
+		}
 		
-		// Falling edge, go LOW on every output
-		for (int i = 0; i < n; i++) {
-			digitalWrite(DIVISIONS_OUTPUT[i], LOW);
-			leds[i].off();
+		if (high) {
+			portHigh[outputPort[i]] |= outputBit[i];
+			if (!HIGH_RATE) {
+				outputs |= bit;
+				outputsRose |= bit;
+			}
+		} else if (low) {
+			portLow[outputPort[i]] |= outputBit[i];
+			if (!HIGH_RATE) outputs &= ~bit;
 		}
 		
 	}
 	
+	writePorts(portHigh, portLow);
+	
+	// Bookkeeping for LEDs and debugging
+	if (!HIGH_RATE) {
+		outputsState = outputs;
+		clockEdges.push(now, clock);
+		if (DEBUG) {
+			unsigned long time = micros() - now;
+			if (time > isrClockMaxTime) isrClockMaxTime = time;
+		}
+	}
+	
 }
 
-void processGateMode() {
+/**
+ * Start the pulses of a swung or ratcheted output, within its divided period measured on the input clock,
+ * with the delays precomputed by loopPulses().
+ * Returns TRUE if the first pulse must go HIGH right now, otherwise it has been scheduled after the swing delay.
+ */
+bool pulseStart(byte i, unsigned long bit, unsigned long now) {
 	
-	// Keep outputs high for ~50% of divided time
-	for (int i = 0; i < n; i++) {
-		
-		// Go HIGH on the rising edges that corresponds to the division (or Euclidean pattern)
-		bool high;
-		int modulo, step;
-		if (!EUCLIDEAN) {
-			modulo = (count % DIVISIONS[i]);
-			high = clock && modulo == 0;
-		} else {
-			step = count % EUCLIDEAN_N_STEPS;
-			high = clock && EUCLIDEAN_RHYTHMS[i][step] == 1;
-		}
-		if (high) {
-			digitalWrite(DIVISIONS_OUTPUT[i], HIGH);
-			leds[i].on();
-		}
-		
-		// Go LOW on rising edges for even divisions and falling edges for odd divisions,
-		// considering the edges that corresponds to the half value of the division
-		bool low;
-		if (!EUCLIDEAN) {
-			bool divisionIsOdd = (DIVISIONS[i] % 2 != 0);
-			low = (modulo == (int)(floor(DIVISIONS[i] / 2.0)));
-			low = low && ((clock && !divisionIsOdd) || (!clock && divisionIsOdd));
+	// Delay every other pulse by the swing amount, and spread the ratchet over the rest of the period
+	bool offbeat = (swingOffbeatMask & bit) != 0;
+	swingOffbeatMask ^= bit;
+	unsigned long delay = offbeat ? swingDelay[i] : 0;
+	pulsesLeft[i] = max(RATCHETS[i], 1);
+	pulseSpacing[i] = ratchetSpacing[offbeat][i];
+	
+	if (delay == 0) {
+		pulses.schedule(i, now + pulseWidth(i), LOW);
+		return true;
+	} else {
+		pulses.schedule(i, now + delay, HIGH);
+		return false;
+	}
+	
+}
+
+/**
+ * Duration of the pulses of a swung or ratcheted output: half of their spacing in gate mode,
+ * the input pulse duration in trigger mode (if shorter)
+ */
+unsigned long pulseWidth(byte i) {
+	unsigned long width = pulseSpacing[i] / 2;
+	if (!gateMode && clockWidth < width) width = clockWidth;
+	return width;
+}
+
+/**
+ * Timer ISR, fire the scheduled edges of swung and ratcheted outputs and advance the PLL of multiplied outputs
+ */
+void isrTick() {
+	
+	unsigned long now = micros();
+	byte portHigh[3] { 0, 0, 0 };
+	byte portLow[3] { 0, 0, 0 };
+	unsigned long outputs = outputsState;
+	
+	byte i;
+	unsigned long time;
+	bool level;
+	while (pulses.pop(now, i, time, level)) {
+		unsigned long bit = 1UL << i;
+		if (level) {
+			
+			// Pulse start, schedule its end
+			portHigh[outputPort[i]] |= outputBit[i];
+			outputs |= bit;
+			outputsRose |= bit;
+			pulses.schedule(i, time + pulseWidth(i), LOW);
+			
 		} else {
-			low = clock && EUCLIDEAN_RHYTHMS[i][step] == 0;
+			
+			// Pulse end, schedule the next pulse of the ratchet (relative to the scheduled time, not to accumulate latency)
+			portLow[outputPort[i]] |= outputBit[i];
+			outputs &= ~bit;
+			if (--pulsesLeft[i] > 0) pulses.schedule(i, time + pulseSpacing[i] - pulseWidth(i), HIGH);
+			
 		}
-		if (low) {
-			digitalWrite(DIVISIONS_OUTPUT[i], LOW);
-			leds[i].off();
+	}
+	
+	// Multiplied outputs, waiting at the end of the period if the next input edge is late
+	if (multipliedMask != 0 && pllPhasePerUs != 0) {
+		unsigned long phase = pllPhase + pllIncrement;
+		pllPhase = phase = phase > pllPhase ? phase : 0xFFFFFFFFUL;
+		unsigned long bit = 1;
+		for (byte i = 0; i < n; i++, bit <<= 1) {
+			if ((multipliedMask & bit) == 0) continue;
+			
+			// High in the first half of each multiplied period, or for the input pulse duration in trigger mode
+			byte m = -DIVISIONS[i];
+			unsigned long p = phase * m;
+			bool high = p < PLL_HALF && (gateMode || (p >> 5) < (pllWidth >> 5) * m); // Scaled down not to overflow, m <= 32
+			
+			if (high && (outputs & bit) == 0) {
+				portHigh[outputPort[i]] |= outputBit[i];
+				outputs |= bit;
+				outputsRose |= bit;
+			} else if (!high && (outputs & bit) != 0) {
+				portLow[outputPort[i]] |= outputBit[i];
+				outputs &= ~bit;
+			}
+			
 		}
-		
 	}
 	
+	writePorts(portHigh, portLow);
+	outputsState = outputs;
+	
 }
 
-void isrClock() {
-	clock = (digitalRead(CLOCK_INPUT) == HIGH);
-	clockFlag = true;
+/**
+ * Write all the outputs at once, a single store for each port
+ */
+void writePorts(byte* portHigh, byte* portLow) {
+	for (byte p = 0; p < 3; p++) {
+		if (outputPortMask[p] != 0) {
+			*outputPortRegister[p] = (*outputPortRegister[p] & ~portLow[p]) | portHigh[p];
+		}
+	}
 }
 
 void isrReset() {
@@ -3,6 +3,8 @@
 
 #include "Arduino.h"
 
+#include "Gesture.cpp"
+
 class Button {
 	
 	public:
@@ -24,6 +26,8 @@ class Button {
 			this->readLongPressOnceFlag = false;
 			this->readShortOrLongPressOnceFlag = false;
 			
+			this->gesture.init();
+			
 			pinMode(this->pin, internalPullup ? INPUT_PULLUP : INPUT);
 			
 		}
@@ -135,6 +139,29 @@ class Button {
 			return r;
 		}
 		
+		/** 
+		 * Recognize taps, holds and holds after taps (see Gesture), with the given tap window and hold duration.
+		 * Returns a Gesture constant once for each gesture, or Gesture::NONE.
+		 */
+		byte readGesture(unsigned int tapMs, unsigned int holdMs) {
+			bool pressed = this->read();
+			if (pressed != this->gesture.isDown()) {
+				if (pressed) {
+					this->gesture.press(millis(), tapMs);
+				} else {
+					this->gesture.release(millis());
+				}
+			}
+			return this->gesture.poll(millis(), tapMs, holdMs);
+		}
+		
+		/** 
+		 * Return the number of taps of the last gesture read by readGesture()
+		 */
+		byte getTaps() {
+			return this->gesture.getTaps();
+		}
+		
 	private:
 		byte pin;
 		unsigned int debounceDelayMs;
@@ -145,6 +172,7 @@ class Button {
 		bool readOnceFlag;
 		bool readLongPressOnceFlag;
 		bool readShortOrLongPressOnceFlag;
+		Gesture gesture;
 		
 };
 
@@ -0,0 +1,94 @@
+#ifndef PeriodEstimator_h
+#define PeriodEstimator_h
+
+#include "Arduino.h"
+
+class PeriodEstimator {
+	
+	public:
+		
+		/**
+		 * Setup the estimator for a periodic signal, like a clock input, specifying the minimum
+		 * accepted period: edges closer than this to the previous one are rejected as bounces.
+		 */
+		void init(unsigned long minPeriodUs) {
+			this->minPeriodUs = minPeriodUs;
+			this->reset();
+		}
+		
+		/**
+		 * Forget every measured interval, the next edge will start a new measurement.
+		 * Optionally keep returning the given period until a new one is measured.
+		 */
+		void reset(unsigned long period = 0) {
+			this->edges = 0;
+			this->lastUs = 0;
+			this->period = period;
+		}
+		
+		/**
+		 * Register an edge of the signal, given its timestamp in microseconds, ideally taken with
+		 * micros() inside the ISR so that it's not affected by main loop latency.
+		 * The period is the median of the last three intervals, so a single late, early or missing
+		 * edge is rejected as an outlier. Returns FALSE if the edge has been rejected as a bounce.
+		 */
+		bool update(unsigned long us) {
+			
+			if (this->edges > 0) {
+				
+				unsigned long interval = us - this->lastUs;
+				if (interval < this->minPeriodUs) return false; // Too fast, bounce
+				
+				// Remember the last three intervals
+				this->intervals[2] = this->intervals[1];
+				this->intervals[1] = this->intervals[0];
+				this->intervals[0] = interval;
+				
+				if (this->edges < 4) this->edges++;
+				if (this->edges < 4) {
+					this->period = interval; // Not enough intervals yet, use the last one
+				} else {
+					this->period = median(this->intervals[0], this->intervals[1], this->intervals[2]);
+				}
+				
+			} else {
+				this->edges = 1;
+			}
+			
+			this->lastUs = us;
+			return true;
+			
+		}
+		
+		/**
+		 * Return the estimated period in microseconds, zero (or the period given to reset()) if at least two
+		 * edges have not been registered yet
+		 */
+		unsigned long get() {
+			return this->period;
+		}
+		
+		/**
+		 * Return the timestamp of the last accepted edge, in microseconds
+		 */
+		unsigned long getLastUs() {
+			return this->lastUs;
+		}
+		
+	private:
+		
+		unsigned long minPeriodUs;
+		unsigned long lastUs;
+		unsigned long intervals[3];
+		unsigned long period;
+		byte edges; // Number of registered edges, up to 4 (i.e. three intervals)
+		
+		static unsigned long median(unsigned long a, unsigned long b, unsigned long c) {
+			if (a > b) { unsigned long x = a; a = b; b = x; }
+			if (b > c) b = c;
+			return a > b ? a : b;
+		}
+		
+};
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef pulse_queue_h
+#define pulse_queue_h
+
+#include "Arduino.h"
+
+// Deadline-ordered queue of output edges, with at most one pending edge for each output.
+// Edges are scheduled and fired from ISRs only, which don't nest on AVR, so no locking is needed.
+
+#define PULSE_QUEUE_CAPACITY 32
+
+class PulseQueue {
+	
+	public:
+		
+		/**
+		 * Constructor
+		 */
+		void init() {
+			this->clear();
+		}
+		
+		/**
+		 * Remove all the pending edges
+		 */
+		void clear() {
+			this->size = 0;
+		}
+		
+		/**
+		 * Schedule the next edge of an output at the given time in microseconds, rising (HIGH) or falling (LOW),
+		 * replacing the pending one if any
+		 */
+		void schedule(byte output, unsigned long time, bool level) {
+			
+			this->cancel(output);
+			
+			// Keep edges sorted by descending deadline, so that the earliest one is popped from the end.
+			// Times are compared by difference, to handle the micros() overflow.
+			byte i = this->size;
+			while (i > 0 && (long)(this->times[i - 1] - time) < 0) {
+				this->times[i] = this->times[i - 1];
+				this->outputs[i] = this->outputs[i - 1];
+				this->levels[i] = this->levels[i - 1];
+				i--;
+			}
+			this->times[i] = time;
+			this->outputs[i] = output;
+			this->levels[i] = level;
+			this->size++;
+			
+		}
+		
+		/**
+		 * Remove the pending edge of an output, if any
+		 */
+		void cancel(byte output) {
+			for (byte i = 0; i < this->size; i++) {
+				if (this->outputs[i] == output) {
+					this->size--;
+					for (byte j = i; j < this->size; j++) {
+						this->times[j] = this->times[j + 1];
+						this->outputs[j] = this->outputs[j + 1];
+						this->levels[j] = this->levels[j + 1];
+					}
+					return;
+				}
+			}
+		}
+		
+		/**
+		 * Take the earliest edge if its deadline has been reached at the given time, returning its output, its level
+		 * and its scheduled time, so that following edges can be scheduled without accumulating latency.
+		 * Returns FALSE if no edge is due.
+		 */
+		bool pop(unsigned long now, byte& output, unsigned long& time, bool& level) {
+			if (this->size == 0) return false;
+			if ((long)(now - this->times[this->size - 1]) < 0) return false;
+			this->size--;
+			output = this->outputs[this->size];
+			time = this->times[this->size];
+			level = this->levels[this->size];
+			return true;
+		}
+		
+	private:
+		
+		unsigned long times[PULSE_QUEUE_CAPACITY];
+		byte outputs[PULSE_QUEUE_CAPACITY];
+		bool levels[PULSE_QUEUE_CAPACITY];
+		byte size;
+		
+};
+
+#endif
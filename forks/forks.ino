@@ -22,6 +22,7 @@ const int PROBABILITY_KNOBS_THRESHOLD_LOW = 0; // Everything read under this val
 const int PROBABILITY_KNOBS_THRESHOLD_HIGH = 1023; // Everything read over this value in the 0-1023 scale is considered the maximum value
 const int PROBABILITY_CV_INPUTS_THRESHOLD_LOW = 6; // Everything read under this value in the 0-1023 scale is considered the minimum value
 const int PROBABILITY_CV_INPUTS_THRESHOLD_HIGH = 670; // Everything read over this value in the 0-1023 scale is considered the maximum value
+const int PROBABILITY_HYSTERESIS = 2; // Knobs and CV inputs changes up to this value in the 0-1023 scale are ignored as noise
 
 const unsigned long BUTTON_DEBOUNCE_DELAY = 50; // Debounce delay for manual input buttons
 const unsigned long LED_MIN_DURATION_MS = 50; // Minimum "on" duration for all LEDs visibility
@@ -30,23 +31,38 @@ const unsigned long LED_MIN_DURATION_MS = 50; // Minimum "on" duration for all L
 
 #include "lib/Button.cpp"
 #include "lib/CV.cpp"
-#include "lib/Led.cpp"
+#include "lib/FastRandom.cpp"
+#include "lib/LedBank.cpp"
+#include "lib/Scheduler.cpp"
 
 unsigned int n = 0; // Number of channels
 
 Button buttons[8];
 CV knobs[8];
 CV cvs[8];
-Led ledsA[8]; // LEDs for outputs A
-Led ledsB[8]; // LEDs for outputs B
+LedBankMask ledsMask; // All the LEDs in the LedBank: the ones for outputs A first, then the ones for outputs B
+FastRandom coin; // Seeded once from hardware noise
 
+// Coins are flipped in the input ISR, or with interrupts disabled for manual buttons, against a probability
+// threshold refreshed by the main loop, so that outputs follow inputs with minimal and constant latency
 volatile bool inputs[8]; // Input signal digital reading, set in ISR
-bool inputsLast[8]; // TRUE if input signal was high or manual button was pressed
-bool outcomeLast[8]; // Last outcome for toggle mode
+volatile bool buttonInputs[8]; // Manual button reading
+volatile bool inputsLast[8]; // TRUE if input signal was high or manual button was pressed
+volatile bool outcomeLast[8]; // Last outcome for toggle mode
+volatile unsigned long probabilityThresholds[8]; // Probability of outcome B, as a fraction of 65536
+volatile uint8_t* inputsRegister[8]; // Input registers, faster than digitalRead()
+byte inputsMask[8];
+volatile uint8_t* outputsARegister[8]; // Output registers, faster than digitalWrite()
+byte outputsAMask[8];
+volatile uint8_t* outputsBRegister[8];
+byte outputsBMask[8];
+volatile byte outputsA = 0; // Current outputs A, bit i is for channel i
+volatile byte outputsB = 0; // Current outputs B
+volatile byte outputsARose = 0; // Outputs A that went high since the LEDs have been updated
+volatile byte outputsBRose = 0; // Outputs B that went high since the LEDs have been updated
 
-bool modeToggle[8]; // TRUE if toggle mode is enabled for the channel
-bool modeLatch[8]; // TRUE if latch mode is enabled for the channel
-unsigned long lastModePollMs = 0; // Modes switches are polled periodically
+volatile bool modeToggle[8]; // TRUE if toggle mode is enabled for the channel
+volatile bool modeLatch[8]; // TRUE if latch mode is enabled for the channel
 
 void setup() {
 	
@@ -62,8 +78,10 @@ void setup() {
 	// Initialize state
 	for (int i = 0; i < n; i++) {
 		inputs[i] = false;
+		buttonInputs[i] = false;
 		inputsLast[i] = false;
 		outcomeLast[i] = false;
+		probabilityThresholds[i] = 32768;
 		modeToggle[i] = false;
 		modeLatch[i] = false;
 	}
@@ -73,8 +91,8 @@ void setup() {
 		buttons[i].init(INPUT_BUTTONS[i], BUTTON_DEBOUNCE_DELAY, true, true);
 		knobs[i].init(PROBABILITY_KNOBS[i], PROBABILITY_KNOBS_THRESHOLD_LOW, PROBABILITY_KNOBS_THRESHOLD_HIGH);
 		cvs[i].init(PROBABILITY_CV_INPUTS[i], PROBABILITY_CV_INPUTS_THRESHOLD_LOW, PROBABILITY_CV_INPUTS_THRESHOLD_HIGH, true);
-		ledsA[i].init(LEDS_A[i], LED_MIN_DURATION_MS);
-		ledsB[i].init(LEDS_B[i], LED_MIN_DURATION_MS);
+		knobs[i].setHysteresis(PROBABILITY_HYSTERESIS);
+		cvs[i].setHysteresis(PROBABILITY_HYSTERESIS);
 		pinMode(OUTPUTS_A[i], OUTPUT);
 		pinMode(OUTPUTS_B[i], OUTPUT);
 		digitalWrite(OUTPUTS_A[i], LOW);
@@ -82,6 +100,29 @@ void setup() {
 		pinMode(MODE_TOGGLE_PINS[i], INPUT_PULLUP);
 		pinMode(MODE_LATCH_PINS[i], INPUT_PULLUP);
 	}
+	for (int i = 0; i < n; i++) LedBank::add(LEDS_A[i], LED_MIN_DURATION_MS);
+	for (int i = 0; i < n; i++) LedBank::add(LEDS_B[i], LED_MIN_DURATION_MS);
+	ledsMask = (1UL << (2 * n)) - 1;
+	
+	// Precompute ports
+	for (int i = 0; i < n; i++) {
+		inputsRegister[i] = portInputRegister(digitalPinToPort(INPUTS[i]));
+		inputsMask[i] = digitalPinToBitMask(INPUTS[i]);
+		outputsARegister[i] = portOutputRegister(digitalPinToPort(OUTPUTS_A[i]));
+		outputsAMask[i] = digitalPinToBitMask(OUTPUTS_A[i]);
+		outputsBRegister[i] = portOutputRegister(digitalPinToPort(OUTPUTS_B[i]));
+		outputsBMask[i] = digitalPinToBitMask(OUTPUTS_B[i]);
+	}
+	
+	// No unconnected analog pins available, seed with watchdog jitter and CV input noise
+	coin.init(FastRandom::entropy(PROBABILITY_CV_INPUTS[0]));
+	
+	// Probabilities and modes before the first input, then keep reading knobs and CVs in background
+	probabilityPolling();
+	modePolling();
+	Scheduler::add(modePolling, MODE_POLL_EVERY_MS); // Then periodically
+	if (DEBUG) Scheduler::add(debugTasks, 4000);
+	AnalogScanner::start();
 	
 	// Interrupts
 	for (int i = 0; i < n; i++) {
@@ -93,98 +134,138 @@ void setup() {
 
 void loop() {
 	
-	modePolling();
+	Scheduler::loop();
+	probabilityPolling();
+	
+	// Manual buttons, handled as the input ISR would do
+	for (int i = 0; i < n; i++) {
+		bool button = buttons[i].read();
+		if (button != buttonInputs[i]) {
+			noInterrupts();
+			buttonInputs[i] = button;
+			channelUpdate(i);
+			interrupts();
+		}
+	}
 	
-	// For each channel
+	// Outputs changed by ISR since the last loop
+	noInterrupts();
+	byte currentA = outputsA;
+	byte currentB = outputsB;
+	byte roseA = outputsARose;
+	byte roseB = outputsBRose;
+	outputsARose = 0;
+	outputsBRose = 0;
+	interrupts();
+	
+	// Show outputs on LEDs, flashing also those that went high and low again in the meanwhile
+	LedBank::flashMask(roseA | (LedBankMask)roseB << n);
+	LedBank::setMask(ledsMask, currentA | (LedBankMask)currentB << n);
+	LedBank::loop();
+	
+	// Debug outcomes of each channel
 	for (int i = 0; i < n; i++) {
+		if (DEBUG && (bitRead(roseA, i) || bitRead(roseB, i))) {
+			Serial.print("CH");
+			Serial.print(i);
+			Serial.print(" -> Gate on -> P: ");
+			noInterrupts();
+			unsigned long threshold = probabilityThresholds[i];
+			interrupts();
+			Serial.print((threshold * 1000) >> 16);
+			Serial.print("/1000");
+			Serial.print(" -> Outcome: ");
+			Serial.println(bitRead(roseA, i) ? 'A' : 'B');
+		}
+	}
+	
+}
+
+void debugTasks() {
+	if (DEBUG) {
+		Serial.print("Max task times:");
+		for (byte i = 0; i < Scheduler::getCount(); i++) {
+			Serial.print(" ");
+			Serial.print(Scheduler::getMaxRunUs(i));
+		}
+		Serial.println(" us");
+	}
+}
+
+void isrInputs() {
+	
+	// Check each channel
+	for (byte i = 0; i < n; i++) {
+		inputs[i] = (*inputsRegister[i] & inputsMask[i]) != 0;
+		channelUpdate(i);
+	}
+	
+}
+
+/**
+ * Route the channel input to the outputs if it changed, call with interrupts disabled
+ */
+void channelUpdate(byte i) {
+	
+	// Channel input changed?
+	bool input = inputs[i] || buttonInputs[i]; // Current input
+	if (input == inputsLast[i]) return;
+	inputsLast[i] = input; // Remember the new input
+	
+	byte bit = 1 << i;
+	if (input) {
+		
+		// Flip coin
+		bool outcome = !coin.chance(probabilityThresholds[i]); // TRUE if random is bigger than probability factor
 		
-		// Channel input changed?
-		bool input = inputs[i] || buttons[i].read(); // Current input
-		if (input != inputsLast[i]) {
-			inputsLast[i] = input; // Remember the new input
-			
-			if (input) {
-				
-				// Calculate probability combining knob and CV
-				float probability;
-				float probabilityKnob = knobs[i].read() * 1.1 - 0.05; // Let the knob push more toward the edges, to compensate for CV values near zero
-				float probabilityCV = cvs[i].read() - 0.5; // Use CV as an offset
-				probability = constrain(probabilityKnob + probabilityCV, 0.0, 1.0);
-				
-				// Flip coin
-				randomSeed(micros()); // No unconnected analog pins available, seed with millis()
-				bool outcome = random(0, 1024) >= (probability * 1024); // TRUE if random is bigger than probability factor
-				
-				// Toggle mode?
-				if (modeToggle[i]) outcome = (outcome == outcomeLast[i]);
-				outcomeLast[i] = outcome;
-				
-				// Turn on output and LED
-				if (outcome) {
-					digitalWrite(OUTPUTS_A[i], HIGH);
-					ledsA[i].on();
-				} else {
-					digitalWrite(OUTPUTS_B[i], HIGH);
-					ledsB[i].on();
-				}
-				
-				// If in latch mode, turn off the other output and LED
-				if (modeLatch[i]) {
-					if (outcome) {
-						digitalWrite(OUTPUTS_B[i], LOW);
-						ledsB[i].off();
-					} else {
-						digitalWrite(OUTPUTS_A[i], LOW);
-						ledsA[i].off();
-					}
-				}
-				
-				if (DEBUG) {
-					Serial.print("CH");
-					Serial.print(i);
-					Serial.print(" -> Gate on -> P: ");
-					Serial.print(probability, 3);
-					Serial.print(" (knob: ");
-					Serial.print(probabilityKnob, 3);
-					Serial.print(", CV: ");
-					Serial.print(probabilityCV, 3);
-					Serial.print(") -> Outcome: ");
-					Serial.println(outcome ? 'A' : 'B');
-				}
-				
-			} else {
-				
-				// If not in latch mode, turn off all outputs and LEDs
-				if (!modeLatch[i]) {
-					digitalWrite(OUTPUTS_A[i], LOW);
-					digitalWrite(OUTPUTS_B[i], LOW);
-					ledsA[i].off();
-					ledsB[i].off();
-				}
-				
-				if (DEBUG) {
-					Serial.print("CH");
-					Serial.print(i);
-					Serial.println(" -> Gate off");
-				}
-				
+		// Toggle mode?
+		if (modeToggle[i]) outcome = (outcome == outcomeLast[i]);
+		outcomeLast[i] = outcome;
+		
+		// Turn on output, and if in latch mode turn off the other one
+		if (outcome) {
+			*outputsARegister[i] |= outputsAMask[i];
+			outputsA |= bit;
+			outputsARose |= bit;
+			if (modeLatch[i]) {
+				*outputsBRegister[i] &= ~outputsBMask[i];
+				outputsB &= ~bit;
+			}
+		} else {
+			*outputsBRegister[i] |= outputsBMask[i];
+			outputsB |= bit;
+			outputsBRose |= bit;
+			if (modeLatch[i]) {
+				*outputsARegister[i] &= ~outputsAMask[i];
+				outputsA &= ~bit;
 			}
-			
 		}
 		
-		// Update LEDs
-		ledsA[i].loop();
-		ledsB[i].loop();
+	} else {
+		
+		// If not in latch mode, turn off all outputs
+		if (!modeLatch[i]) {
+			*outputsARegister[i] &= ~outputsAMask[i];
+			*outputsBRegister[i] &= ~outputsBMask[i];
+			outputsA &= ~bit;
+			outputsB &= ~bit;
+		}
 		
 	}
 	
 }
 
-void isrInputs() {
+void probabilityPolling() {
 	
-	// Check each channel
+	// Calculate probability combining knob and CV, in background and in fixed point, only if any of them moved
 	for (int i = 0; i < n; i++) {
-		inputs[i] = (digitalRead(INPUTS[i]) == HIGH);
+		if (!(knobs[i].changed() | cvs[i].changed())) continue; // Check both, without short-circuit
+		long probabilityKnob = CV::mulQ15(knobs[i].readQ15(), Q15(1.1)) - Q15(0.05); // Let the knob push more toward the edges, to compensate for CV values near zero
+		long probabilityCV = (long)cvs[i].readQ15() - Q15(0.5); // Use CV as an offset
+		unsigned long threshold = (unsigned long)CV::clampQ15(probabilityKnob + probabilityCV) << 1; // Fraction of 65536
+		noInterrupts();
+		probabilityThresholds[i] = threshold;
+		interrupts();
 	}
 	
 }
@@ -192,15 +273,9 @@ void isrInputs() {
 void modePolling() {
 	
 	// Poll modes switches
-	unsigned long ms = millis();
-	if (lastModePollMs == 0 || ms >= (lastModePollMs + MODE_POLL_EVERY_MS)) {
-		lastModePollMs = ms > 0 ? ms : 1; // Avoid to re-set zero
-		
-		for (int i = 0; i < n; i++) {
-			modeToggle[i] = (digitalRead(MODE_TOGGLE_PINS[i]) == HIGH);
-			modeLatch[i] = (digitalRead(MODE_LATCH_PINS[i]) == HIGH);
-		}
-		
+	for (int i = 0; i < n; i++) {
+		modeToggle[i] = (digitalRead(MODE_TOGGLE_PINS[i]) == HIGH);
+		modeLatch[i] = (digitalRead(MODE_LATCH_PINS[i]) == HIGH);
 	}
 	
 }
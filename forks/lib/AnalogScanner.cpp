@@ -0,0 +1,136 @@
+#ifndef AnalogScanner_h
+#define AnalogScanner_h
+
+#include "Arduino.h"
+
+// Reads analog pins in background, in free-running mode from the ADC conversion complete interrupt (ATmega328P),
+// so that readings don't block the main loop. Pins are scanned in turn: each reading is the sum of a few samples
+// (oversampling), smoothed by a one-pole low-pass filter. analogRead() can't be used while the scanner is running.
+
+#define ANALOG_SCANNER_CHANNELS 8
+#define ANALOG_SCANNER_NONE 255 // Returned by add() when all the channels are taken, always reads zero
+
+class AnalogScanner {
+	
+	public:
+		
+		/**
+		 * Add a pin to the scan, returning its channel to be used with get(), or ANALOG_SCANNER_NONE if all the
+		 * channels are taken. Call this before start().
+		 */
+		static byte add(byte pin) {
+			if (pin >= A0) pin -= A0; // Same as analogRead()
+			for (byte i = 0; i < AnalogScanner::count; i++) {
+				if (AnalogScanner::inputs[i] == pin) return i;
+			}
+			if (AnalogScanner::count == ANALOG_SCANNER_CHANNELS) return ANALOG_SCANNER_NONE;
+			AnalogScanner::inputs[AnalogScanner::count] = pin;
+			return AnalogScanner::count++;
+		}
+		
+		/**
+		 * Start scanning the added pins, in the same order they have been added.
+		 * Each pin is read once right away, so that a value is available immediately.
+		 */
+		static void start() {
+			if (AnalogScanner::count == 0) return;
+			for (byte i = 0; i < AnalogScanner::count; i++) {
+				AnalogScanner::values[i] = analogRead(AnalogScanner::inputs[i]) << (FRACTION_BITS + OVERSAMPLING_BITS);
+			}
+			uint8_t oldSREG = SREG;
+			cli();
+			AnalogScanner::current = 0;
+			AnalogScanner::samples = 0;
+			AnalogScanner::sum = 0;
+			AnalogScanner::skip = 0;
+			ADMUX = _BV(REFS0) | AnalogScanner::inputs[0]; // AVcc reference, as analogRead()
+			ADCSRB = 0; // Free-running mode
+			ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0); // 125 kHz ADC clock
+			AnalogScanner::running = true;
+			SREG = oldSREG;
+		}
+		
+		/**
+		 * Return TRUE if the scan is running
+		 */
+		static bool isRunning() {
+			return AnalogScanner::running;
+		}
+		
+		/**
+		 * Return the latest filtered reading of a channel, in the same 0-1023 range of analogRead(), without blocking.
+		 * It's rounded, since the filter settles a few fractional units below a rising input.
+		 */
+		static int get(byte channel) {
+			if (channel >= AnalogScanner::count) return 0;
+			uint8_t oldSREG = SREG;
+			cli();
+			unsigned int value = AnalogScanner::values[channel];
+			SREG = oldSREG;
+			return (value + (1 << (FRACTION_BITS + OVERSAMPLING_BITS - 1))) >> (FRACTION_BITS + OVERSAMPLING_BITS);
+		}
+		
+		/**
+		 * Handle a completed conversion, called from the ADC interrupt
+		 */
+		static void isr() {
+			
+			int sample = ADC;
+			
+			// A conversion was already running when the input has been switched, it belongs to the previous one
+			if (AnalogScanner::skip > 0) {
+				AnalogScanner::skip--;
+				return;
+			}
+			
+			// Oversampling
+			AnalogScanner::sum += sample;
+			if (++AnalogScanner::samples < (1 << OVERSAMPLING_BITS)) return;
+			
+			// One-pole low-pass filter, in fixed point
+			byte c = AnalogScanner::current;
+			long value = (long)AnalogScanner::sum << FRACTION_BITS;
+			AnalogScanner::values[c] += (value - (long)AnalogScanner::values[c]) >> FILTER_SHIFT; // Signed difference
+			AnalogScanner::sum = 0;
+			AnalogScanner::samples = 0;
+			
+			// Next input
+			if (AnalogScanner::count > 1) {
+				AnalogScanner::current = c = (c + 1 < AnalogScanner::count) ? c + 1 : 0;
+				ADMUX = _BV(REFS0) | AnalogScanner::inputs[c];
+				AnalogScanner::skip = 1;
+			}
+			
+		}
+		
+	private:
+		
+		static const byte OVERSAMPLING_BITS = 2; // Sum of 4 samples, for 12 bits readings
+		static const byte FRACTION_BITS = 4; // Fixed point filter state, in 16 bits
+		static const byte FILTER_SHIFT = 2; // Filter coefficient 1/4
+		
+		static byte inputs[ANALOG_SCANNER_CHANNELS];
+		static byte count;
+		static volatile unsigned int values[ANALOG_SCANNER_CHANNELS];
+		static byte current; // Channel being sampled
+		static byte samples; // Samples summed so far
+		static unsigned int sum;
+		static byte skip; // Samples to discard
+		static volatile bool running;
+		
+};
+
+byte AnalogScanner::inputs[ANALOG_SCANNER_CHANNELS];
+byte AnalogScanner::count = 0;
+volatile unsigned int AnalogScanner::values[ANALOG_SCANNER_CHANNELS];
+byte AnalogScanner::current = 0;
+byte AnalogScanner::samples = 0;
+unsigned int AnalogScanner::sum = 0;
+byte AnalogScanner::skip = 0;
+volatile bool AnalogScanner::running = false;
+
+ISR(ADC_vect) {
+	AnalogScanner::isr();
+}
+
+#endif
@@ -3,6 +3,12 @@
 
 #include "Arduino.h"
 
+#include "AnalogScanner.cpp"
+
+// Fixed-point values with 15 fractional bits, 32768 is 1.0: constants are converted at compile time
+#define Q15(x) ((long)((x) * 32768.0 + 0.5))
+#define Q15_ONE 32768L
+
 class CV {
 	
 	public:
@@ -18,12 +24,40 @@ class CV {
 			this->thresholdHigh = thresholdHigh;
 			this->invert = invert;
 			
+			// Reciprocal of the range for the fixed-point mapping, the product with a reading fits in 32 bits
+			this->scale = (1UL << 31) / max(thresholdHigh - thresholdLow, 1); // Q15_ONE << 16, unsigned to fit 32 bits
+			
+			this->channel = AnalogScanner::add(pin);
+			
+			this->hysteresis = 0;
+			this->held = -1024; // No reading yet, the first one is a change
+			this->changedFlag = false;
+			
+		}
+		
+		/**
+		 * Ignore changes of the reading up to the given amount (in the 0-1023 scale of analogRead()),
+		 * so that noise doesn't make the reading flicker nor changed() return TRUE
+		 */
+		void setHysteresis(int hysteresis) {
+			this->hysteresis = hysteresis;
+		}
+		
+		/**
+		 * Return TRUE if the reading changed (beyond hysteresis) since the last read() or readQ15(),
+		 * so that any computation depending on it can be skipped otherwise
+		 */
+		bool changed() {
+			this->update();
+			return this->changedFlag;
 		}
 		
 		/**
-		 * Return the raw reading, as returned by analogRead()
+		 * Return the raw reading, as returned by analogRead(),
+		 * or the latest filtered one without blocking if AnalogScanner has been started
 		 */
 		int readRaw() {
+			if (AnalogScanner::isRunning()) return AnalogScanner::get(this->channel);
 			return analogRead(this->pin);
 		}
 		
@@ -33,7 +67,8 @@ class CV {
 		 */
 		float read() {
 			
-			int r = this->readRaw();
+			int r = this->update();
+			this->changedFlag = false;
 			float f;
 			
 			if (r <= this->thresholdLow) {
@@ -52,12 +87,72 @@ class CV {
 			
 		}
 		
+		/**
+		 * Same as read(), but the reading is returned in fixed point between 0 and 32768 (1.0) included,
+		 * without any float operation
+		 */
+		unsigned int readQ15() {
+			
+			int r = this->update();
+			this->changedFlag = false;
+			unsigned int q;
+			
+			if (r <= this->thresholdLow) {
+				q = 0;
+			} else if (r >= this->thresholdHigh) {
+				q = Q15_ONE;
+			} else {
+				q = ((unsigned long)(r - this->thresholdLow) * this->scale + 0x8000) >> 16;
+			}
+			
+			if (this->invert) {
+				return Q15_ONE - q;
+			} else {
+				return q;
+			}
+			
+		}
+		
+		/**
+		 * Multiply two fixed-point values, factors can be negative or greater than 1.0
+		 */
+		static long mulQ15(long a, long b) {
+			return (a * b) >> 15;
+		}
+		
+		/**
+		 * Constrain a fixed-point value between 0 and 1.0
+		 */
+		static unsigned int clampQ15(long a) {
+			return a < 0 ? 0 : (a > Q15_ONE ? Q15_ONE : a);
+		}
+		
 	private:
+		
+		/**
+		 * Take a new reading, keeping the previous one if it moved less than hysteresis (unless it reached a threshold)
+		 */
+		int update() {
+			int r = this->readRaw();
+			bool railLow = r <= this->thresholdLow && this->held > this->thresholdLow;
+			bool railHigh = r >= this->thresholdHigh && this->held < this->thresholdHigh;
+			if (abs(r - this->held) > this->hysteresis || railLow || railHigh) {
+				this->held = r;
+				this->changedFlag = true;
+			}
+			return this->held;
+		}
+		
 		byte pin;
 		int thresholdLow;
 		int thresholdHigh;
 		bool invert;
+		unsigned long scale; // Reciprocal of the thresholds range, in fixed point
+		byte channel; // AnalogScanner channel
+		int hysteresis;
+		int held; // Last reading that moved beyond hysteresis
+		bool changedFlag;
 		
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,384 @@
+#ifndef LedBank_h
+#define LedBank_h
+
+#include "Arduino.h"
+
+// A set of LEDs refreshed all at once by a single loop() call, with the same features of the Led class.
+// States are kept as bitmasks (bit i for LED i, as returned by add()), and changes only mark the LEDs as dirty.
+// Blink phases advance with the time elapsed since the previous refresh, by subtraction, and pins are written
+// only when their state actually changes, a port at a time. Times are kept in 16 bits.
+// Optionally, brightness and fades are rendered with bit angle modulation from the Timer2 compare interrupt
+// (ATmega328P): each bit of the brightness is a plane of port values, shown for a time proportional to its weight.
+// The interrupt fires once per plane and just writes the ports, whatever the number of LEDs.
+// Up to 16 LEDs by default, define LED_BANK_SIZE before including this file for up to 32, with 32-bit masks.
+
+#ifndef LED_BANK_SIZE
+#define LED_BANK_SIZE 16
+#endif
+#define LED_BANK_NONE 255 // Returned by add() when the bank is full, ignored by the other methods
+
+#if LED_BANK_SIZE > 32
+#error "LedBank supports up to 32 LEDs"
+#elif LED_BANK_SIZE > 16
+typedef unsigned long LedBankMask;
+#else
+typedef unsigned int LedBankMask;
+#endif
+
+class LedBank {
+	
+	public:
+		
+		/**
+		 * Add a LED, specifying and optional minimum "on" duration for user visibility, returning its index,
+		 * or LED_BANK_NONE if the bank is full
+		 */
+		static byte add(byte pin, unsigned int minDurationMs = 0) {
+			byte i = LedBank::count;
+			if (i == LED_BANK_SIZE) return LED_BANK_NONE;
+			pinMode(pin, OUTPUT);
+			digitalWrite(pin, LOW);
+			LedBank::ports[i] = digitalPinToPort(pin) - PB; // 0 for PORTB, 1 for PORTC, 2 for PORTD
+			LedBank::masks[i] = digitalPinToBitMask(pin);
+			LedBank::minDurationMs[i] = minDurationMs;
+			LedBank::brightness[i] = 255;
+			LedBank::portMasks[LedBank::ports[i]] |= LedBank::masks[i];
+			LedBank::count++;
+			return i;
+		}
+		
+		/**
+		 * Turn the LED on or off, as soon as loop() is called.
+		 * If a minimum duration was set, it could not turn off if it was on for too little.
+		 */
+		static void set(byte i, bool state) {
+			if (i >= LedBank::count) return;
+			LedBankMask bit = (LedBankMask)1 << i;
+			LedBank::blinking &= ~bit; // Stop blinking
+			if (state) {
+				LedBank::states |= bit;
+				LedBank::lastOnMs[i] = millis(); // Remember last time it was requested to be on
+			} else if ((LedBank::states & bit) != 0) {
+				LedBank::states &= ~bit;
+				LedBank::holding |= bit; // Keep it on until the minimum duration
+			}
+			LedBank::dirty = true;
+		}
+		
+		static void on(byte i) {
+			LedBank::set(i, true);
+		}
+		
+		static void off(byte i) {
+			LedBank::set(i, false);
+		}
+		
+		static void toggle(byte i) {
+			if (i >= LedBank::count) return;
+			LedBank::set(i, (LedBank::states & ((LedBankMask)1 << i)) == 0);
+		}
+		
+		/**
+		 * Turn on the LED, then turn it off immediately.
+		 * A single impulse of light will be visible if LED's minDurationMs is long enough.
+		 */
+		static void flash(byte i) {
+			LedBank::set(i, true);
+			LedBank::set(i, false);
+		}
+		
+		/**
+		 * Set the state of all the LEDs in the mask at once, bit i for LED i
+		 */
+		static void setMask(LedBankMask mask, LedBankMask states) {
+			LedBankMask rising = mask & states & ~LedBank::states;
+			LedBankMask falling = mask & ~states & LedBank::states;
+			if ((rising | falling | (LedBank::blinking & mask)) == 0) return; // Nothing changed
+			LedBank::blinking &= ~mask;
+			LedBank::states = (LedBank::states & ~mask) | (mask & states);
+			LedBank::holding |= falling;
+			LedBank::touch(rising);
+			LedBank::dirty = true;
+		}
+		
+		/**
+		 * Flash all the LEDs in the mask at once, bit i for LED i
+		 */
+		static void flashMask(LedBankMask mask) {
+			if (mask == 0) return;
+			LedBank::blinking &= ~mask;
+			LedBank::states &= ~mask;
+			LedBank::holding |= mask;
+			LedBank::touch(mask);
+			LedBank::dirty = true;
+		}
+		
+		/**
+		 * Starts blinking with given period, until any other method is called.
+		 * Use duty to specify how long the LED will be on, and invert to flip the blinking phase.
+		 */
+		static void blink(byte i, unsigned int periodMs, float duty = 0.5, bool invert = false) {
+			if (i >= LedBank::count || periodMs == 0) return;
+			LedBank::blinkPeriodMs[i] = periodMs;
+			LedBank::blinkDutyMs[i] = max(0, min(periodMs, duty * periodMs));
+			unsigned int phase = invert && LedBank::blinkDutyMs[i] < periodMs ? LedBank::blinkDutyMs[i] : 0;
+			if ((LedBank::blinking | LedBank::fading) == 0) {
+				LedBank::lastLoopMs = millis(); // The shared tick wasn't running
+			} else {
+				unsigned int late = (unsigned int)millis() - LedBank::lastLoopMs; // Will be added by the next loop()
+				while (late > phase) phase += periodMs;
+				phase -= late;
+			}
+			LedBank::blinkPhaseMs[i] = phase;
+			LedBank::blinking |= (LedBankMask)1 << i;
+			LedBank::dirty = true;
+		}
+		
+		/**
+		 * Set the brightness of the LED while on, from 0 to 255, stopping any fade. It needs startPwm().
+		 */
+		static void setBrightness(byte i, byte brightness) {
+			if (i >= LedBank::count) return;
+			LedBank::fading &= ~((LedBankMask)1 << i);
+			if (LedBank::brightness[i] != brightness) {
+				LedBank::brightness[i] = brightness;
+				LedBank::dirty = true;
+				LedBank::planesDirty = true;
+			}
+		}
+		
+		/**
+		 * Change the brightness of the LED gradually, reaching the given one (0 to 255) in the given time.
+		 * The brightness changes by at most one step per millisecond. It needs startPwm().
+		 */
+		static void fade(byte i, byte brightness, unsigned int durationMs) {
+			if (i >= LedBank::count) return;
+			byte steps = abs(brightness - LedBank::brightness[i]);
+			if (steps == 0) {
+				LedBank::setBrightness(i, brightness);
+				return;
+			}
+			LedBank::fadeTarget[i] = brightness;
+			LedBank::fadeStepMs[i] = max(1, durationMs / steps);
+			LedBank::fadeElapsedMs[i] = 0;
+			if ((LedBank::blinking | LedBank::fading) == 0) LedBank::lastLoopMs = millis(); // The shared tick wasn't running
+			LedBank::fading |= (LedBankMask)1 << i;
+			LedBank::dirty = true;
+		}
+		
+		/**
+		 * Drive the LEDs from the Timer2 interrupt, for brightness and fades.
+		 * Timer2 can't be used for other purposes, including analogWrite() on pins 3 and 11.
+		 */
+		static void startPwm() {
+			uint8_t oldSREG = SREG;
+			cli();
+			LedBank::pwm = true;
+			LedBank::planesDirty = true;
+			LedBank::plane = LedBank::PWM_BITS - 1; // The first interrupt shows the first plane
+			TCCR2A = _BV(WGM21); // Clear timer on compare match
+			TCCR2B = _BV(CS22) | _BV(CS20); // Prescaler 128, 8 us per count
+			TCNT2 = 0;
+			OCR2A = 0;
+			TIFR2 = _BV(OCF2A);
+			TIMSK2 = _BV(OCIE2A);
+			SREG = oldSREG;
+			LedBank::dirty = true;
+			LedBank::loop();
+		}
+		
+		/**
+		 * Show the next plane, called from the timer interrupt.
+		 * The port values of the plane are written as they are, so that the cost is the same for each plane.
+		 */
+		static void isr() {
+			byte k = LedBank::plane + 1;
+			if (k == LedBank::PWM_BITS) k = 0;
+			TCNT2 = 0; // Still at the previous compare value, the count would go on past a new one: restart it
+			OCR2A = LedBank::PWM_PLANE_COUNTS[k];
+			PORTB = (PORTB & ~LedBank::portMasks[0]) | LedBank::planes[k][0];
+			PORTC = (PORTC & ~LedBank::portMasks[1]) | LedBank::planes[k][1];
+			PORTD = (PORTD & ~LedBank::portMasks[2]) | LedBank::planes[k][2];
+			LedBank::plane = k;
+		}
+		
+		/**
+		 * Set the optional minimum "on" duration for user visibility
+		 */
+		static void setMinDurationMs(byte i, unsigned int minDurationMs = 0) {
+			if (i >= LedBank::count) return;
+			LedBank::minDurationMs[i] = minDurationMs;
+			LedBank::dirty = true;
+		}
+		
+		/**
+		 * Refresh all the LEDs. Call this in the main loop.
+		 */
+		static void loop() {
+			
+			// Nothing to do unless something changed, or is waiting for time to pass
+			if (!LedBank::dirty && (LedBank::holding | LedBank::blinking | LedBank::fading) == 0) return;
+			LedBank::dirty = false;
+			
+			// Shared tick
+			unsigned int now = millis();
+			unsigned int elapsed = now - LedBank::lastLoopMs;
+			LedBank::lastLoopMs = now;
+			
+			// Turn off the LEDs that have been on for their minimum duration
+			LedBankMask holding = LedBank::holding;
+			for (byte i = 0; holding != 0; i++, holding >>= 1) {
+				if ((holding & 1) != 0 && now - LedBank::lastOnMs[i] >= LedBank::minDurationMs[i]) {
+					LedBank::holding &= ~((LedBankMask)1 << i);
+				}
+			}
+			LedBankMask target = LedBank::states | LedBank::holding;
+			
+			// Advance the blinking phases
+			LedBankMask blinking = LedBank::blinking;
+			if (blinking != 0) {
+				target &= ~blinking;
+				for (byte i = 0; blinking != 0; i++, blinking >>= 1) {
+					if ((blinking & 1) == 0) continue;
+					unsigned int phase = LedBank::blinkPhaseMs[i] + elapsed;
+					while (phase >= LedBank::blinkPeriodMs[i]) phase -= LedBank::blinkPeriodMs[i];
+					LedBank::blinkPhaseMs[i] = phase;
+					if (phase < LedBank::blinkDutyMs[i]) target |= (LedBankMask)1 << i;
+				}
+			}
+			
+			// Advance the fades
+			LedBankMask fading = LedBank::fading;
+			for (byte i = 0; fading != 0; i++, fading >>= 1) {
+				if ((fading & 1) == 0) continue;
+				unsigned int t = LedBank::fadeElapsedMs[i] + elapsed;
+				byte b = LedBank::brightness[i];
+				while (t >= LedBank::fadeStepMs[i] && b != LedBank::fadeTarget[i]) {
+					t -= LedBank::fadeStepMs[i];
+					b += b < LedBank::fadeTarget[i] ? 1 : -1;
+				}
+				LedBank::fadeElapsedMs[i] = t;
+				if (b != LedBank::brightness[i]) {
+					LedBank::brightness[i] = b;
+					LedBank::planesDirty = true;
+				}
+				if (b == LedBank::fadeTarget[i]) LedBank::fading &= ~((LedBankMask)1 << i);
+			}
+			
+			// Planes for the timer interrupt
+			if (LedBank::pwm) {
+				if (target == LedBank::hardware && !LedBank::planesDirty) return;
+				LedBank::hardware = target;
+				LedBank::planesDirty = false;
+				byte planes[LedBank::PWM_BITS][3];
+				memset(planes, 0, sizeof(planes));
+				for (byte i = 0; target != 0; i++, target >>= 1) {
+					if ((target & 1) == 0) continue;
+					byte level = LedBank::brightness[i] >> (8 - LedBank::PWM_BITS);
+					for (byte k = 0; level != 0; k++, level >>= 1) {
+						if ((level & 1) != 0) planes[k][LedBank::ports[i]] |= LedBank::masks[i];
+					}
+				}
+				uint8_t oldSREG = SREG;
+				cli();
+				memcpy((void*)LedBank::planes, planes, sizeof(planes));
+				SREG = oldSREG;
+				return;
+			}
+			
+			// Write the pins that changed, a port at a time
+			LedBankMask changed = target ^ LedBank::hardware;
+			if (changed == 0) return;
+			LedBank::hardware = target;
+			byte setMasks[3] = { 0, 0, 0 };
+			byte clearMasks[3] = { 0, 0, 0 };
+			for (byte i = 0; changed != 0; i++, changed >>= 1) {
+				if ((changed & 1) == 0) continue;
+				if ((target & ((LedBankMask)1 << i)) != 0) {
+					setMasks[LedBank::ports[i]] |= LedBank::masks[i];
+				} else {
+					clearMasks[LedBank::ports[i]] |= LedBank::masks[i];
+				}
+			}
+			uint8_t oldSREG = SREG;
+			cli(); // Other pins of the same ports could be written from ISRs
+			if ((setMasks[0] | clearMasks[0]) != 0) PORTB = (PORTB & ~clearMasks[0]) | setMasks[0];
+			if ((setMasks[1] | clearMasks[1]) != 0) PORTC = (PORTC & ~clearMasks[1]) | setMasks[1];
+			if ((setMasks[2] | clearMasks[2]) != 0) PORTD = (PORTD & ~clearMasks[2]) | setMasks[2];
+			SREG = oldSREG;
+			
+		}
+		
+	private:
+		
+		static const byte PWM_BITS = 6; // Brightness resolution, 64 levels refreshed at about 500 Hz
+		static const byte PWM_PLANE_COUNTS[PWM_BITS]; // Timer2 compare values for the duration of each plane
+		
+		static byte count;
+		static byte ports[LED_BANK_SIZE];
+		static byte masks[LED_BANK_SIZE];
+		static unsigned int minDurationMs[LED_BANK_SIZE];
+		static unsigned int lastOnMs[LED_BANK_SIZE];
+		static unsigned int blinkPeriodMs[LED_BANK_SIZE];
+		static unsigned int blinkDutyMs[LED_BANK_SIZE];
+		static unsigned int blinkPhaseMs[LED_BANK_SIZE];
+		static byte brightness[LED_BANK_SIZE];
+		static byte fadeTarget[LED_BANK_SIZE];
+		static unsigned int fadeStepMs[LED_BANK_SIZE];
+		static unsigned int fadeElapsedMs[LED_BANK_SIZE];
+		
+		static LedBankMask states; // Requested state
+		static LedBankMask holding; // Turned off, but kept on until the minimum duration
+		static LedBankMask blinking;
+		static LedBankMask fading;
+		static LedBankMask hardware; // Current pins state
+		static bool dirty;
+		static unsigned int lastLoopMs;
+		
+		// Bit angle modulation
+		static bool pwm;
+		static bool planesDirty;
+		static byte portMasks[3]; // All the LEDs, by port (B, C, D)
+		static volatile byte planes[LedBank::PWM_BITS][3]; // Port values for each bit of the brightness
+		static volatile byte plane; // Plane being shown
+		
+		static void touch(LedBankMask mask) {
+			unsigned int now = millis();
+			for (byte i = 0; mask != 0; i++, mask >>= 1) {
+				if ((mask & 1) != 0) LedBank::lastOnMs[i] = now;
+			}
+		}
+		
+};
+
+byte LedBank::count = 0;
+byte LedBank::ports[LED_BANK_SIZE];
+byte LedBank::masks[LED_BANK_SIZE];
+unsigned int LedBank::minDurationMs[LED_BANK_SIZE];
+unsigned int LedBank::lastOnMs[LED_BANK_SIZE];
+unsigned int LedBank::blinkPeriodMs[LED_BANK_SIZE];
+unsigned int LedBank::blinkDutyMs[LED_BANK_SIZE];
+unsigned int LedBank::blinkPhaseMs[LED_BANK_SIZE];
+byte LedBank::brightness[LED_BANK_SIZE];
+byte LedBank::fadeTarget[LED_BANK_SIZE];
+unsigned int LedBank::fadeStepMs[LED_BANK_SIZE];
+unsigned int LedBank::fadeElapsedMs[LED_BANK_SIZE];
+LedBankMask LedBank::states = 0;
+LedBankMask LedBank::holding = 0;
+LedBankMask LedBank::blinking = 0;
+LedBankMask LedBank::fading = 0;
+LedBankMask LedBank::hardware = 0;
+bool LedBank::dirty = false;
+unsigned int LedBank::lastLoopMs = 0;
+bool LedBank::pwm = false;
+bool LedBank::planesDirty = false;
+byte LedBank::portMasks[3] = { 0, 0, 0 };
+volatile byte LedBank::planes[LedBank::PWM_BITS][3];
+volatile byte LedBank::plane = 0;
+const byte LedBank::PWM_PLANE_COUNTS[LedBank::PWM_BITS] = { 4, 8, 16, 32, 64, 128 }; // 32 us for the first plane
+
+ISR(TIMER2_COMPA_vect) {
+	LedBank::isr();
+}
+
+#endif
@@ -8,6 +8,8 @@ const bool DEBUG = false; // FALSE to disable debug messages on serial port
 const byte CLOCK_INPUT = 2; // Pin for the input clock signal, must be usable for interrupts
 const byte CLOCK_LED = 13; // LED pin for input clock signal indication
 const unsigned int CLOCK_RESOLUTION = 8; // Resolution of the input clock, for example 8 to make clock count 8th notes (use only multiples of 2)
+const unsigned int INTERNAL_CLOCK_BPM = 120; // Initial tempo of the internal clock, used when no external clock is connected
+const unsigned long EXTERNAL_CLOCK_TIMEOUT_MS = 2000; // After the first pulse of an external clock, how long to wait for the second one before the internal clock takes over again
 
 const byte PERFORMER_BUTTONS[] { 0, 1, 3, 4, 5, 6 }; // Button pins for performer advancing
 const byte PERFORMER_GATE_LEDS[] { 7, 8, 9, 10, 11, 12 }; // LEDs pins for showing output gates
@@ -16,6 +18,7 @@ const byte PERFORMER_ALERT_BEHIND = 3; // LED will start blinking if performer i
 const byte RESET_BUTTON = A0; // Pin for the reset button
 const unsigned long RESET_BUTTON_LONG_PRESS_MS = 4000; // The reset button must be long-pressed to reset
 const unsigned long DISPLAY_LATE_PERFORMERS_MS = 2000; // How long lit up the LEDs to display late performers
+const unsigned long TAP_TEMPO_MAX_MS = 2000; // Reset button presses closer than this set the internal clock tempo, one press per beat (tap tempo)
 
 const byte GATES_SHIFT_REGISTER_DATA = A3; // 74HC595 serial data input (SER)
 const byte GATES_SHIFT_REGISTER_CLOCK = A1; // 74HC595 shift register clock (SCK)
@@ -26,7 +29,7 @@ const float ACCIACCATURA_LENGTH = 0.4; // Length of the acciaccatura note, as a
 
 const unsigned long BUTTON_DEBOUNCE_DELAY = 50; // Debounce delay for all buttons
 const unsigned long SEQUENCE_STOP_LONG_PRESS_MS = 500; // Button long-press duration to request sequence stop
-const unsigned long PERFORMER_BUTTON_MULTI_ADVANCE_MS = 400; // Multi-press delay for the performer button to advance more than one pattern
+const unsigned int PERFORMER_BUTTON_MULTI_ADVANCE_MS = 400; // Maximum delay between performer button taps to advance more than one pattern
 
 const unsigned long LED_MIN_DURATION_MS = 50; // Minimum "on" duration for all LEDs visibility
 const unsigned int LED_BLINK_PERIOD = 120; // Blink rate while waiting for a sequence to stop
@@ -37,10 +40,13 @@ const float LED_BLINK_DUTY = 0.1; // Blink duty cycle, to adjust overall brightn
 #include <Wire.h>
 #include <avr/pgmspace.h>
 
-#include "lib/Button.cpp"
-#include "lib/Led.cpp"
+#include "lib/ButtonBank.cpp"
+#include "lib/LedBank.cpp"
 #include "lib/MCP4728.cpp"
 #include "lib/MultiPointMap.cpp"
+#include "lib/PeriodEstimator.cpp"
+#include "lib/PeriodicTimer.cpp"
+#include "lib/Scheduler.cpp"
 #include "lib/SR74HC595.cpp"
 #include "patterns/patterns.h"
 
@@ -61,23 +67,26 @@ MultiPointMap calibration[N_MAX];
 SR74HC595 gates;
 
 // Reset button
-Button resetButton;
+byte resetButton; // Index in the ButtonBank
 unsigned long displayLatePerformersTime = 0; // A short press make LEDs display late performers for a couple of seconds
 
 // Each performer is playing a pattern, pressing the button will make it advance to the next.
 // At the beginning each performer is in an initial state, where it outputs a constant CV for tuning and no gate.
 byte n; // Number of performers
-Button performerButton[N_MAX]; // Button for advancing the performer to the next sequence
-Led performerGateLed[N_MAX]; // LED for showing performer's output gates
+byte performerButton[N_MAX]; // Button for advancing the performer to the next sequence, index in the ButtonBank
+byte performerGateLed[N_MAX]; // LED for showing performer's output gates, index in the LedBank
 int8_t patternCurrent[N_MAX]; // Current pattern index, -1 if in initial state 
 int8_t patternNext[N_MAX]; // Pattern to load when the current one loops
 int8_t patternLeader = 0; // Pattern currently played by the more advanced performer
 bool performerIsBehind[N_MAX]; // TRUE of the performer is lagging too far behind the leader
-unsigned long performerButtonLastTime[N_MAX]; // Last time the performer button has been pressed to advance pattern
 
 // The duration of a clock cycle, in steps
 const unsigned int CLOCK_DURATION = PATTERNS_DURATION_RESOLUTION / CLOCK_RESOLUTION; 
 
+// The position between two clock pulses is a fixed-point number of steps, with this many fractional bits
+#define PHASE_BITS 8
+#define PHASE_MASK 0xFF
+
 // When a pattern is loaded, a simpler "sequence" is created, where each note is repeated to reach its original duration.
 // This is like an ordinary sequencer's setup, where each single step has the same duration, that is the smallest possible.
 byte sequenceStep[N_MAX][SEQUENCE_SIZE_MAX];
@@ -87,7 +96,6 @@ unsigned int sequenceAcciaccatura[N_MAX]; // Note CV for the acciaccatura note a
 unsigned int sequenceAcciaccaturaTo[N_MAX]; // Target note CV for the acciaccatura
 unsigned int sequencePlayhead[N_MAX]; // The index of the current step in the sequence
 unsigned int sequencePlayheadClocked[N_MAX]; // A playhead that is moved forward by CLOCK_DURATION steps every clock pulse
-unsigned long sequenceLastStepTime[N_MAX];
 unsigned int sequenceLastCV[N_MAX];
 bool sequenceLastGate[N_MAX];
 bool sequenceStopped[N_MAX];
@@ -102,11 +110,33 @@ bool sequenceStoppedToggleRequest[N_MAX];
 
 // The input clock makes the sequences advance by CLOCK_DURATION steps.
 // Each time a clock pulse is received, the sequence's clocked playhead is moved forward.
+// Pulses are timestamped in the ISR, so that step timing is not affected by main loop latency.
 volatile bool clockFlag = false; // Clock signal change flag, set in the clock ISR
-unsigned long clockLastTime = 0; // Time of the last clock pulse
+volatile unsigned long clockIsrTime = 0; // Time of the last clock pulse in us, set in the clock ISR
+PeriodEstimator clockPeriod; // Filtered clock period, rejecting bounces and outliers
+unsigned long clockLastTime = 0; // Time of the last clock pulse, in us
 unsigned long clockCount = 0; // Clock pulses global counter
-unsigned long stepTime = 0; // The duration in ms of a sequence step, it depends on clock frequency
-Led clockLed;
+unsigned long stepTime = 0; // The duration in us of a sequence step, it depends on clock frequency
+
+// Without an external clock, pulses are generated by a hardware timer at the last known tempo.
+// The internal clock takes over if an external pulse is missed, and stops on the first external pulse.
+// The period of the external clock is then measured from scratch (steps keep the internal tempo meanwhile),
+// before it can be missed again.
+volatile bool clockInternal = false; // TRUE while the internal clock is running
+volatile bool clockExternalRestart = false; // Set in the clock ISR when an external clock replaces the internal one
+bool clockExternalLocking = false; // TRUE until the period of the restarted external clock is known
+unsigned long clockInternalPeriod = (60000000UL * 4 / INTERNAL_CLOCK_BPM) / CLOCK_RESOLUTION; // In us, a measure is four beats
+PeriodEstimator tapTempo; // Period of the reset button presses, for tap tempo
+unsigned long tapTempoLastTime = 0; // Time of the last reset button press, in ms
+byte clockLed; // Index in the LedBank
+
+// CV and gate changes are collected in an output frame during each pass, and then committed at once:
+// CVs first, and gates latched right after, so that a new gate never plays the previous note.
+unsigned int frameCV[8]; // Calibrated DAC values
+byte frameGates = 0; // Shift register value
+bool frameCVChanged[2] { false, false }; // For each DAC
+bool frameGatesChanged = false;
+unsigned long frameCommitMaxTime = 0; // Longest commit in us, for debugging
 
 bool calibrating = false; // TRUE if currently running the calibration process
 byte calibratingPerformer; // Performer currently being calibrated
@@ -117,7 +147,8 @@ unsigned long calibrationButtonLast[2]; // Last time a calibration button press
 // Address of DACs calibration data in EEPROM memory
 const int DAC_CALIBRATION_EEPROM_ADDRESS = 100;
 
-unsigned long statusDebugLastTime = 0;
+byte calibrationTask; // Indexes in the Scheduler
+byte debugStatusTask;
 
 void setup() {
 	
@@ -138,14 +169,12 @@ void setup() {
 	}
 	
 	// Reset button
-	resetButton.init(RESET_BUTTON, BUTTON_DEBOUNCE_DELAY, true, true);
+	resetButton = ButtonBank::add(RESET_BUTTON, true, true);
 	
 	// Init performers and their sequences
 	for (byte p = 0; p < n; p++) {
-		performerButton[p].init(PERFORMER_BUTTONS[p], BUTTON_DEBOUNCE_DELAY, true, true);
-		performerGateLed[p].init(PERFORMER_GATE_LEDS[p]);
-		performerButtonLastTime[p] = 0;
-		sequenceLastStepTime[p] = 0;
+		performerButton[p] = ButtonBank::add(PERFORMER_BUTTONS[p], true, true);
+		performerGateLed[p] = LedBank::add(PERFORMER_GATE_LEDS[p]);
 	}
 	
 	// Init shift register for gates
@@ -173,13 +202,16 @@ void setup() {
 		calibrationAddress += calibration[p].load(calibrationAddress);
 	}
 	
-	// Init clock
-	clockLed.init(CLOCK_LED);
+	// Init clock, the minimum period avoids being too fast (a measure shorter than 500ms) and filters clock rising bounces
+	clockLed = LedBank::add(CLOCK_LED);
+	clockPeriod.init(500000UL / CLOCK_RESOLUTION);
+	tapTempo.init(500000UL / 4);
 	pinMode(CLOCK_INPUT, INPUT);
 	
 	// If reset button is pressed on boot, start calibration process
 	delay(100);
-	if (resetButton.readOnce()) {
+	ButtonBank::start(BUTTON_DEBOUNCE_DELAY, PERFORMER_BUTTON_MULTI_ADVANCE_MS);
+	if (ButtonBank::readOnce(resetButton)) {
 		setupCalibration();
 	} else {
 		setupMain();
@@ -189,14 +221,17 @@ void setup() {
 
 void setupMain() {
 	
+	if (DEBUG) debugStatusTask = Scheduler::add(debugStatus, 4000);
+	
 	bootAnimation();
 	
 	// Set minimum "on" duration on LEDs
-	clockLed.setMinDurationMs(LED_MIN_DURATION_MS);
-	for (byte p = 0; p < n; p++) performerGateLed[p].setMinDurationMs(LED_MIN_DURATION_MS);
+	LedBank::setMinDurationMs(clockLed, LED_MIN_DURATION_MS);
+	for (byte p = 0; p < n; p++) LedBank::setMinDurationMs(performerGateLed[p], LED_MIN_DURATION_MS);
 	
 	// Start listening for input clock
 	attachInterrupt(digitalPinToInterrupt(CLOCK_INPUT), clockISR, RISING);
+	PeriodicTimer::init(clockInternalISR);
 	
 	reset(0);
 	
@@ -211,7 +246,8 @@ void setupCalibration() {
 	calibratingAddress = DAC_CALIBRATION_EEPROM_ADDRESS;
 	calibrationButtonLast[0] = 0;
 	calibrationButtonLast[1] = 0;
-	clockLed.on();
+	LedBank::on(clockLed);
+	calibrationTask = Scheduler::add(calibrationUpdate, 50);
 	
 }
 
@@ -221,7 +257,7 @@ void reset(unsigned long t) {
 	patternLeader = 0;
 	displayLatePerformersTime = 0;
 	for (byte p = 0; p < n; p++) {
-		performerGateLed[p].off();
+		LedBank::off(performerGateLed[p]);
 		patternCurrent[p] = -1;
 		patternNext[p] = -1;
 		performerIsBehind[p] = false;
@@ -235,18 +271,12 @@ void reset(unsigned long t) {
 	}
 	
 	// Tuning mode, setting all DACs to a fixed reference
-	gates.write(0);
-	unsigned int dacValues[8];
-	for (byte i = 0; i < 8; i++) {
-		if (i < n) {
-			sequenceLastCV[i] = TUNING_CV;
-			dacValues[i] = calibration[i].map(TUNING_CV);
-		} else {
-			dacValues[i] = 0;
-		}
+	for (byte p = 0; p < n; p++) {
+		sequenceLastCV[p] = TUNING_CV;
+		frameSetCV(p, TUNING_CV);
+		frameSetGate(p, false);
 	}
-	dac1.analogWrite(dacValues[0], dacValues[1], dacValues[2], dacValues[3]);
-	if (n > 4) dac2.analogWrite(dacValues[4], dacValues[5], dacValues[6], dacValues[7]);
+	frameCommit();
 	
 	if (DEBUG) {
 		if (t > 0) Serial.println(F("RESET"));
@@ -262,8 +292,8 @@ void loop() {
 		loopMain();
 	}
 	
-	clockLed.loop();
-	for (byte p = 0; p < n; p++) performerGateLed[p].loop();
+	Scheduler::loop();
+	LedBank::loop();
 	
 }
 
@@ -272,46 +302,70 @@ void loopMain() {
 	unsigned long t = millis();
 	
 	if (clockFlag) {
+		noInterrupts();
+		unsigned long clockTime = clockIsrTime;
+		bool clockRestart = clockExternalRestart;
 		clockFlag = false;
-		clockLoop(t);
+		clockExternalRestart = false;
+		interrupts();
+		if (clockRestart) {
+			clockPeriod.reset(clockInternalPeriod); // Forget the intervals of the internal clock, but keep its tempo until the new one is measured
+		}
+		if (clockLoop(clockTime)) {
+			clockExternalLocking = clockRestart; // Locked on the pulse after the first one
+		}
 	}
 	
+	// Let the internal clock take over if the external one is missing a pulse (or is not connected at all).
+	// A restarted external clock could be much slower than the internal one, so its second pulse is waited longer.
+	// Checked with interrupts disabled, so that a pulse arriving meanwhile can't be overridden by the internal clock.
+	unsigned long clockTimeout = 2 * clockPeriod.get();
+	if (clockExternalLocking) clockTimeout = max(clockTimeout, EXTERNAL_CLOCK_TIMEOUT_MS * 1000);
+	noInterrupts();
+	unsigned long clockLast = clockFlag ? clockIsrTime : clockLastTime; // A pulse not handled yet is the last one
+	if (!clockInternal && micros() - clockLast > clockTimeout) {
+		clockInternal = true;
+		PeriodicTimer::start(clockInternalPeriod, clockInternalPeriod); // First pulse now, it's already late
+	}
+	interrupts();
+	
 	if (stepTime > 0) {
-		sequenceLoop(t);
+		sequenceLoop(micros()); // Read after the clock, to never be behind the last pulse
 	}
 	
-	// Sequence button: advance to next pattern, or request sequence stop on long press
+	// Sequence button: advance to next pattern (more than one with multiple taps), or request sequence stop on long press
 	for (byte p = 0; p < n; p++) {
-		byte performerButtonRead = performerButton[p].readShortOrLongPressOnce(SEQUENCE_STOP_LONG_PRESS_MS);
-		if (performerButtonRead == 1 && !sequenceStopped[p]) {
-			if (patternNext[p] <= patternCurrent[p] || (t - performerButtonLastTime[p]) <= PERFORMER_BUTTON_MULTI_ADVANCE_MS) {
-				patternAdvance(p);
+		byte gesture = ButtonBank::readGesture(performerButton[p], SEQUENCE_STOP_LONG_PRESS_MS);
+		if (gesture == Gesture::NONE) continue;
+		if (gesture != Gesture::HOLD && !sequenceStopped[p]) {
+			byte taps = ButtonBank::getTaps(performerButton[p]);
+			for (byte i = 0; i < taps; i++) {
+				if (i > 0 || patternNext[p] <= patternCurrent[p]) patternAdvance(p);
 			}
-			performerButtonLastTime[p] = t;
-		} else if (performerButtonRead > 0) {
+		}
+		if (gesture != Gesture::TAP || sequenceStopped[p]) {
 			if (patternCurrent[p] >= 0) { // If not in initial state
 				sequenceStoppedToggle(p);
 			}
 		}
 	}
 	
-	// Reset button
-	byte resetButtonRead = resetButton.readShortOrLongPressOnce(RESET_BUTTON_LONG_PRESS_MS);
+	// Reset button: a short press displays late performers, the following ones close enough are tempo taps
+	byte resetButtonRead = ButtonBank::readShortOrLongPressOnce(resetButton, RESET_BUTTON_LONG_PRESS_MS);
+	bool tap = resetButtonRead == 1 && t - tapTempoLastTime <= TAP_TEMPO_MAX_MS;
 	if (resetButtonRead == 2) reset(t);
-	displayLatePerformers(resetButtonRead == 1, t);
-	
-	if (DEBUG) {
-		if (t > statusDebugLastTime + 4000) debugStatus(t);
-	}
+	if (resetButtonRead == 1) tapTempoLoop(t);
+	displayLatePerformers(resetButtonRead == 1 && !tap, t);
 	
 }
 
 void loopCalibration() {
 	
 	// Button advance through calibration points and performers
-	if (resetButton.readOnce()) {
+	if (ButtonBank::readOnce(resetButton)) {
 		bool calibrationCompleted = calibrationAdvance();
 		if (calibrationCompleted) {
+			Scheduler::stop(calibrationTask);
 			setupMain();
 			return;
 		}
@@ -319,12 +373,12 @@ void loopCalibration() {
 	
 	// Show which performer is currently being calibrated
 	for (byte p = 0; p < n; p++) {
-		performerGateLed[p].set(p == calibratingPerformer);
+		LedBank::set(performerGateLed[p], p == calibratingPerformer);
 	}
 	
 	// Adjust calibration offset with the first two buttons
 	for (int i = 0; i < 2; i++) {
-		if (performerButton[i].read()) {
+		if (ButtonBank::read(performerButton[i])) {
 			if (millis() >= calibrationButtonLast[i] + 200) {
 				int offset = i > 0 ? 1 : -1; // The second button increases the point value
 				int v = calibration[calibratingPerformer].get(calibratingInterval); // Current point value
@@ -336,10 +390,6 @@ void loopCalibration() {
 		}
 	}
 	
-	if (millis() % 50 == 0) {
-		calibrationUpdate();
-	}
-	
 }
 
 void patternAdvance(byte p) {
@@ -366,7 +416,7 @@ void patternAdvance(byte p) {
 	
 }
 
-void patternLoad(byte p, byte i, int offset, unsigned long t) {
+void patternLoad(byte p, byte i, int offset) {
 	
 	// Create the sequence from the pattern
 	unsigned int length = 0;
@@ -403,10 +453,10 @@ void patternLoad(byte p, byte i, int offset, unsigned long t) {
 				performerIsBehind[pp] = patternCurrent[pp] < patternLeader - PERFORMER_ALERT_BEHIND + 1;
 				if (performerIsBehind[pp]) {
 					if (!sequenceStopped[pp]) {
-						performerGateLed[pp].blink(LED_BLINK_PERIOD, LED_BLINK_DUTY); // Start blinking to alert
+						LedBank::blink(performerGateLed[pp], LED_BLINK_PERIOD, LED_BLINK_DUTY); // Start blinking to alert
 					}
 				} else if (!sequenceStoppedToggleRequest[pp]) {
-					performerGateLed[pp].off();
+					LedBank::off(performerGateLed[pp]);
 				}
 			}
 		}
@@ -424,7 +474,7 @@ void patternLoad(byte p, byte i, int offset, unsigned long t) {
 		Serial.print(F(" - Length: "));
 		Serial.print(sequenceLength[p]);
 		Serial.println(F(" bytes"));
-		if (i > 0) debugStatus(t);
+		if (i > 0) debugStatus();
 	}
 	
 }
@@ -442,20 +492,23 @@ void patternLoadInitial(byte p) {
 	
 }
 
-void clockLoop(unsigned long t) {
+bool clockLoop(unsigned long t) {
 	
-	if (clockLastTime > 0) {
+	if (clockPeriod.update(t)) { // FALSE on clock rising bounces
 		
-		// The whole measure duration is the clock period multiplied by the clock resolution.
-		// For example, if the clock has a period of 20ms and its resolution is 16th, a measure is 320ms long
-		unsigned long measureTime = (t - clockLastTime) * CLOCK_RESOLUTION;
-		if (measureTime > 500) { // Avoid being too fast, this also filters clock rising bounces
+		if (clockPeriod.get() > 0) {
+			
+			// The whole measure duration is the clock period multiplied by the clock resolution.
+			// For example, if the clock has a period of 20ms and its resolution is 16th, a measure is 320ms long
+			unsigned long measureTime = clockPeriod.get() * CLOCK_RESOLUTION;
 			
 			// Update the duration of the sequence step
 			stepTime = measureTime / PATTERNS_DURATION_RESOLUTION;
-			clockLastTime = t;
 			clockCount++;
 			
+			// Keep the tempo of the external clock in case it disappears
+			if (!clockInternal) clockInternalPeriod = clockPeriod.get();
+			
 			for (byte p = 0; p < n; p++) {
 				
 				// Move the clocked playheads
@@ -467,32 +520,56 @@ void clockLoop(unsigned long t) {
 					sequenceStopped[p] = false;
 					sequencePlayheadClocked[p] = 0;
 					if (performerIsBehind[p]) {
-						performerGateLed[p].blink(LED_BLINK_PERIOD, LED_BLINK_DUTY); // Restart blinking if it's behind
+						LedBank::blink(performerGateLed[p], LED_BLINK_PERIOD, LED_BLINK_DUTY); // Restart blinking if it's behind
 					}
 				}
 				
 			}
 			
-			clockLed.flash();
+			LedBank::flash(clockLed);
 			
 		}
 		
-	} else {
 		clockLastTime = t;
+		return true;
+		
 	}
 	
+	return false;
+	
 }
 
-void sequenceLoop(unsigned long t) {
+void tapTempoLoop(unsigned long t) {
 	
-	// Flags that will tell if it's necessary to update CV DACs and gates SR
-	bool updateCV[] { false, false }; // On each DAC
-	bool updateGates = false;
+	// Taps too far apart start a new measurement
+	if (t - tapTempoLastTime > TAP_TEMPO_MAX_MS) tapTempo.reset();
+	tapTempoLastTime = t;
+	
+	// Set the internal clock tempo, without restarting it. The external clock, if any, keeps its tempo.
+	if (tapTempo.update(micros()) && tapTempo.get() > 0) {
+		clockInternalPeriod = (tapTempo.get() * 4) / CLOCK_RESOLUTION;
+		if (clockInternal) PeriodicTimer::setPeriod(clockInternalPeriod);
+		
+		if (DEBUG) {
+			Serial.print(F("TAP TEMPO - Clock time: "));
+			Serial.print(clockInternalPeriod);
+			Serial.println(F(" us"));
+		}
+		
+	}
+	
+}
+
+void sequenceLoop(unsigned long t) {
 	
 	// Get the sequence playhead position: start from the clock playhead (which is incremented by many steps
 	// every clock cycle) and move forward depending on how much time has passed from last clock pulse.
 	// Don't move past the next expected clock, i.e. don't move more than clock duration minus 1.
-	unsigned int stepsAheadOfClock = min((t - clockLastTime) / stepTime, CLOCK_DURATION - 1);
+	unsigned int phase = clockPhase(t - clockLastTime);
+	unsigned int stepsAheadOfClock = phase >> PHASE_BITS;
+	
+	// Time elapsed from the beginning of the current step, which starts at an exact fraction of the clock period
+	unsigned long stepElapsed = t - clockLastTime - (stepsAheadOfClock * clockPeriod.get()) / CLOCK_DURATION;
 	
 	for (byte p = 0; p < n; p++) {
 		
@@ -516,12 +593,12 @@ void sequenceLoop(unsigned long t) {
 						// The sequence must be stopped
 						sequenceStoppedToggleRequest[p] = false;
 						sequenceStopped[p] = true;
-						performerGateLed[p].off(); // Stop blinking, you're done waiting to stop
+						LedBank::off(performerGateLed[p]); // Stop blinking, you're done waiting to stop
 						
 					} else if (patternCurrent[p] != patternNext[p]) {
 						
 						// There's a next pattern to load
-						patternLoad(p, patternNext[p], 0, t);
+						patternLoad(p, patternNext[p], 0);
 						playhead = playhead % sequenceLength[p]; // Adjust playhead to new pattern
 						sequencePlayheadClocked[p] = integerModulo(playhead - stepsAheadOfClock, sequenceLength[p]);
 						playheadOffset = playhead;
@@ -533,7 +610,7 @@ void sequenceLoop(unsigned long t) {
 				// If playhead moved into a non-loaded part of the sequence, load a new chunk
 				if (sequenceLength[p] > SEQUENCE_SIZE_MAX) {
 					if ((playhead < sequenceOffset[p]) || (playhead >= sequenceOffset[p] + SEQUENCE_SIZE_MAX)) {
-						patternLoad(p, patternCurrent[p], playhead, t);
+						patternLoad(p, patternCurrent[p], playhead);
 						playheadOffset = 0;
 					}
 				}
@@ -542,7 +619,6 @@ void sequenceLoop(unsigned long t) {
 				if (!sequenceStopped[p]) {
 					sequencePlayhead[p] = playhead;
 					cv = PATTERNS_CV[sequenceStep[p][playheadOffset] & STEP_CV_MASK];
-					sequenceLastStepTime[p] = t;
 				}
 				
 			}
@@ -551,10 +627,10 @@ void sequenceLoop(unsigned long t) {
 				
 				// Should play the acciaccatura note in this step?
 				// The acciaccatura must be played at the end of the last step in the loop, to "anticipate" the first note!
-				unsigned long acciaccaturaLengthMs = 0;
+				unsigned long acciaccaturaLength = 0;
 				if (sequenceAcciaccatura[p] > 0) {
 					if (playhead == sequenceLength[p] - 1) {
-						acciaccaturaLengthMs = stepTime * ACCIACCATURA_LENGTH;
+						acciaccaturaLength = stepTime * ACCIACCATURA_LENGTH;
 					}
 				}
 				
@@ -563,21 +639,21 @@ void sequenceLoop(unsigned long t) {
 				if (gateInfo == 1) {
 					gate = true;
 				} else if (gateInfo == 2) {
-					unsigned long gateRetrig = GATE_RETRIG_MS + acciaccaturaLengthMs;
-					gate = t < sequenceLastStepTime[p] + max(5, (long)stepTime - (long)gateRetrig); // Cast to avoid unsigned underflow
+					unsigned long gateRetrig = GATE_RETRIG_MS * 1000UL + acciaccaturaLength;
+					gate = (long)stepElapsed < max(5000L, (long)stepTime - (long)gateRetrig); // Cast to avoid unsigned underflow
 				} else if (gateInfo == 3) {
 					gate = true;
 					unsigned int cvFrom = PATTERNS_CV[sequenceStep[p][playheadOffset] & STEP_CV_MASK];
 					unsigned int cvTo = PATTERNS_CV[sequenceStep[p][playheadOffset + 1] & STEP_CV_MASK]; // Unsafe, won't work if the slide crosses the loaded chunk
-					float interpolationFactor = (float)(t - sequenceLastStepTime[p]) / stepTime;
+					float interpolationFactor = (float)(phase & PHASE_MASK) / (PHASE_MASK + 1);
 					cv = interpolate(cvFrom, cvTo, interpolationFactor, 4);
 				}
 				
 				// Play the acciaccatura!
-				if (acciaccaturaLengthMs > 0) {
-					if (t >= sequenceLastStepTime[p] + stepTime - acciaccaturaLengthMs) {
+				if (acciaccaturaLength > 0) {
+					if (stepElapsed >= stepTime - acciaccaturaLength) {
 						gate = true;
-						float interpolationFactor = (float)(t - (sequenceLastStepTime[p] + stepTime - acciaccaturaLengthMs)) / acciaccaturaLengthMs;
+						float interpolationFactor = (float)(stepElapsed - (stepTime - acciaccaturaLength)) / acciaccaturaLength;
 						cv = interpolate(sequenceAcciaccatura[p], sequenceAcciaccaturaTo[p], interpolationFactor, 8);
 					}
 				}
@@ -587,37 +663,67 @@ void sequenceLoop(unsigned long t) {
 		}
 		
 		if (cv != 0 && cv != sequenceLastCV[p]) {
-			updateCV[p < 4 ? 0 : 1] = true;
+			frameSetCV(p, cv);
 			sequenceLastCV[p] = cv;
 		}
 		
 		if (gate != sequenceLastGate[p]) {
-			updateGates = true;
+			frameSetGate(p, gate);
 			sequenceLastGate[p] = gate;
 			
 			// Flash when gate goes on, unless it's already blinking for a pending stop request, or because
 			// the performer is lagging too far behind the leader, or fixed to display late performers
 			if (gate && !performerIsBehind[p] && !sequenceStoppedToggleRequest[p] && displayLatePerformersTime == 0) {
-				performerGateLed[p].flash();
+				LedBank::flash(performerGateLed[p]);
 			}
 			
 		}
 		
 	}
 	
-	if (updateCV[0] || updateCV[1]) {
-		unsigned int dacValues[8];
-		for (byte i = 0; i < 8; i++) dacValues[i] = i < n ? calibration[i].map(sequenceLastCV[i]) : 0;
-		if (updateCV[0]) dac1.analogWrite(dacValues[0], dacValues[1], dacValues[2], dacValues[3]);
-		if (updateCV[1]) dac2.analogWrite(dacValues[4], dacValues[5], dacValues[6], dacValues[7]);
+	frameCommit();
+	
+}
+
+void frameSetCV(byte p, unsigned int cv) {
+	frameSetRawCV(p, calibration[p].map(cv));
+}
+
+void frameSetRawCV(byte p, unsigned int value) {
+	if (value != frameCV[p]) {
+		frameCV[p] = value;
+		frameCVChanged[p < 4 ? 0 : 1] = true;
+	}
+}
+
+void frameSetGate(byte p, bool gate) {
+	if (gate != bitRead(frameGates, p)) {
+		bitWrite(frameGates, p, gate);
+		frameGatesChanged = true;
 	}
+}
+
+void frameCommit() {
+	
+	unsigned long t = micros();
+	
+	// CVs first, a single write for each DAC...
+	if (frameCVChanged[0]) dac1.analogWrite(frameCV[0], frameCV[1], frameCV[2], frameCV[3]);
+	if (frameCVChanged[1]) dac2.analogWrite(frameCV[4], frameCV[5], frameCV[6], frameCV[7]);
 	
-	if (updateGates) {
-		byte srValue = 0;
-		for (byte i = 0; i < 8; i++) if (i < n && sequenceLastGate[i]) bitSet(srValue, i);
-		gates.write(srValue);
+	// ...then gates, as soon as CVs are settled
+	if (frameGatesChanged) gates.write(frameGates);
+	
+	if (DEBUG) {
+		if (frameCVChanged[0] || frameCVChanged[1] || frameGatesChanged) {
+			frameCommitMaxTime = max(frameCommitMaxTime, micros() - t);
+		}
 	}
 	
+	frameCVChanged[0] = false;
+	frameCVChanged[1] = false;
+	frameGatesChanged = false;
+	
 }
 
 void sequenceStoppedToggle(byte p) {
@@ -625,13 +731,13 @@ void sequenceStoppedToggle(byte p) {
 		if (!sequenceStopped[p]) {
 			sequenceStoppedToggleRequest[p] = false; // Undo the pending request
 			if (!performerIsBehind[p]) {
-				performerGateLed[p].off(); // Stop blinking
+				LedBank::off(performerGateLed[p]); // Stop blinking
 			}
 		}
 	} else {
 		sequenceStoppedToggleRequest[p] = true; // Request sequence stop when loop ends
 		if (!sequenceStopped[p] && !performerIsBehind[p]) {
-			performerGateLed[p].blink(LED_BLINK_PERIOD, LED_BLINK_DUTY); // Blink while waiting to stop
+			LedBank::blink(performerGateLed[p], LED_BLINK_PERIOD, LED_BLINK_DUTY); // Blink while waiting to stop
 		}
 	}
 }
@@ -650,9 +756,9 @@ void displayLatePerformers(bool display, unsigned long t) {
 		}
 		for (byte p = 0; p < n; p++) {
 			if (patternCurrent[p] >= 0 && patternCurrent[p] <= patternTail) {
-				performerGateLed[p].on();
+				LedBank::on(performerGateLed[p]);
 			} else {
-				performerGateLed[p].off();
+				LedBank::off(performerGateLed[p]);
 			}
 		}
 		
@@ -663,9 +769,9 @@ void displayLatePerformers(bool display, unsigned long t) {
 			displayLatePerformersTime = 0;
 			for (byte p = 0; p < n; p++) {
 				if (performerIsBehind[p] && !sequenceStopped[p]) {
-					performerGateLed[p].blink(LED_BLINK_PERIOD, LED_BLINK_DUTY); // Restart blinking if it's behind
+					LedBank::blink(performerGateLed[p], LED_BLINK_PERIOD, LED_BLINK_DUTY); // Restart blinking if it's behind
 				} else {
-					performerGateLed[p].off();
+					LedBank::off(performerGateLed[p]);
 				}
 			}
 		}
@@ -675,6 +781,20 @@ void displayLatePerformers(bool display, unsigned long t) {
 }
 
 void clockISR() {
+	clockIsrTime = micros();
+	clockFlag = true;
+	
+	// An external clock has been connected, stop the internal one
+	if (clockInternal) {
+		clockInternal = false;
+		clockExternalRestart = true;
+		PeriodicTimer::stop();
+	}
+	
+}
+
+void clockInternalISR() {
+	clockIsrTime = micros();
 	clockFlag = true;
 }
 
@@ -690,8 +810,8 @@ boolean calibrationAdvance() {
 		// Calibration completed?
 		if (calibratingPerformer == n) {
 			calibrating = false;
-			for (byte p = 0; p < n; p++) performerGateLed[p].off();
-			clockLed.off();
+			for (byte p = 0; p < n; p++) LedBank::off(performerGateLed[p]);
+			LedBank::off(clockLed);
 			delay(1000);
 			return true;
 		}
@@ -706,23 +826,36 @@ void calibrationUpdate() {
 	unsigned int size = calibration[calibratingPerformer].size();
 	unsigned int step = calibration[calibratingPerformer].getStep();
 	unsigned int value = step * (calibratingInterval + 1);
-	unsigned int dacValues[8];
-	for (byte i = 0; i < 8; i++) {
-		if (i < n) {
-			if (calibratingPerformer == i) {
-				dacValues[i] = calibration[i].map(value);
-			} else {
-				dacValues[i] = calibratingPerformer > i ? calibration[i].map(step * size) : 0;
-			}
+	for (byte p = 0; p < n; p++) {
+		if (calibratingPerformer == p) {
+			frameSetCV(p, value);
+		} else if (calibratingPerformer > p) {
+			frameSetCV(p, step * size);
 		} else {
-			dacValues[i] = 0;
+			frameSetRawCV(p, 0); // Not calibrated yet, exactly 0V
 		}
+		
+		// Update gates
+		frameSetGate(p, calibratingPerformer == p);
+		
 	}
-	dac1.analogWrite(dacValues[0], dacValues[1], dacValues[2], dacValues[3]);
-	if (n > 4) dac2.analogWrite(dacValues[4], dacValues[5], dacValues[6], dacValues[7]);
+	frameCommit();
+	
+}
+
+unsigned int clockPhase(unsigned long elapsed) {
+	
+	// Fraction of the measured clock period, scaled to CLOCK_DURATION steps in fixed-point. The playhead is
+	// moved exactly CLOCK_DURATION steps per clock pulse, so no truncation error can accumulate.
+	unsigned long period = clockPeriod.get();
+	if (elapsed >= period) return (CLOCK_DURATION << PHASE_BITS) - 1; // Wait for the next clock on the last step
 	
-	// Update gates
-	gates.write(1 << calibratingPerformer);
+	// Scale both terms down to avoid overflowing the product on slow clocks
+	while (elapsed > 0xFFFFFFFFUL / (CLOCK_DURATION << PHASE_BITS)) {
+		elapsed >>= 1;
+		period >>= 1;
+	}
+	return (elapsed * (CLOCK_DURATION << PHASE_BITS)) / period;
 	
 }
 
@@ -735,14 +868,21 @@ unsigned int interpolate(unsigned int a, unsigned int b, float factor, float exp
 	return (1 - f) * a + f * b;
 }
 
-void debugStatus(unsigned long t) {
+void debugStatus() {
 	if (DEBUG) {
-		statusDebugLastTime = t;
+		Scheduler::start(debugStatusTask, 4000); // Postpone the next periodic status
 		Serial.print(F("STATUS - Step time: "));
 		Serial.print(stepTime);
-		Serial.print(F(" ms - Clock time: "));
-		Serial.print(stepTime * CLOCK_DURATION);
-		Serial.print(F(" ms - Patterns"));
+		Serial.print(F(" us - Clock time: "));
+		Serial.print(clockPeriod.get());
+		Serial.print(F(" us - Max commit time: "));
+		Serial.print(frameCommitMaxTime);
+		Serial.print(F(" us - Max task times:"));
+		for (byte i = 0; i < Scheduler::getCount(); i++) {
+			Serial.print(F(" "));
+			Serial.print(Scheduler::getMaxRunUs(i));
+		}
+		Serial.print(F(" us - Patterns"));
 		for (byte p = 0; p < n; p++) {
 			Serial.print(F(" #"));
 			if (patternCurrent[p] >= 0) {
@@ -767,18 +907,22 @@ void debugStatus(unsigned long t) {
 void bootAnimation() {
 	
 	// Turn on all LEDs
-	clockLed.on();
+	LedBank::on(clockLed);
+	LedBank::loop();
 	for (byte p = 0; p < n; p++) {
 		delay(100);
-		performerGateLed[p].on();
+		LedBank::on(performerGateLed[p]);
+		LedBank::loop();
 	}
 	
 	// Wait and turn them off
 	delay(200);
-	clockLed.off();
+	LedBank::off(clockLed);
+	LedBank::loop();
 	delay(100);
 	for (byte p = 0; p < n; p++) {
-		performerGateLed[p].off();
+		LedBank::off(performerGateLed[p]);
+		LedBank::loop();
 		delay(100);
 	}
 	delay(200);
@@ -0,0 +1,79 @@
+#ifndef EdgeQueue_h
+#define EdgeQueue_h
+
+#include "Arduino.h"
+
+// Lock-free queue of timestamped signal edges, filled by a single ISR and drained by the main loop,
+// so that no edge is lost if the main loop is busy. Indexes are single bytes, hence atomic on AVR.
+
+class EdgeQueue {
+	
+	public:
+		
+		/**
+		 * Setup an empty queue
+		 */
+		void init() {
+			this->head = 0;
+			this->tail = 0;
+			this->overflows = 0;
+		}
+		
+		/**
+		 * Add an edge, call this from the ISR only.
+		 * If the queue is full the edge is dropped and counted as an overflow, and FALSE is returned.
+		 */
+		bool push(unsigned long time, byte value) {
+			byte next = (this->head + 1) & MASK;
+			if (next == this->tail) {
+				this->overflows++;
+				return false;
+			}
+			this->edges[this->head].time = time;
+			this->edges[this->head].value = value;
+			this->head = next; // Publish the edge only when completely written
+			return true;
+		}
+		
+		/**
+		 * Take the oldest edge, call this from the main loop only.
+		 * Returns FALSE if the queue is empty.
+		 */
+		bool pop(unsigned long& time, byte& value) {
+			byte tail = this->tail;
+			if (tail == this->head) return false;
+			time = this->edges[tail].time;
+			value = this->edges[tail].value;
+			this->tail = (tail + 1) & MASK; // Free the slot only when completely read
+			return true;
+		}
+		
+		/**
+		 * Return the number of edges dropped because the queue was full
+		 */
+		unsigned int getOverflows() {
+			uint8_t oldSREG = SREG;
+			cli();
+			unsigned int overflows = this->overflows;
+			SREG = oldSREG;
+			return overflows;
+		}
+		
+	private:
+		
+		static const byte SIZE = 16; // Must be a power of 2
+		static const byte MASK = SIZE - 1;
+		
+		struct Edge {
+			unsigned long time;
+			byte value;
+		};
+		
+		volatile Edge edges[SIZE];
+		volatile byte head; // Next slot to write, owned by the ISR
+		volatile byte tail; // Next slot to read, owned by the main loop
+		volatile unsigned int overflows;
+		
+};
+
+#endif
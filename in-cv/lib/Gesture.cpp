@@ -0,0 +1,98 @@
+#ifndef Gesture_h
+#define Gesture_h
+
+#include "Arduino.h"
+
+// Recognizes button gestures from press and release edges: a number of taps, a hold, or a hold after some taps.
+// Taps are chained when each press starts within the tap window from the previous release, and the sequence
+// is reported once the window expires with no new press. State is just 4 bytes, and polling is a single check
+// while the button is idle. Times are kept in 16 bits, so windows and holds must be shorter than 65 seconds.
+
+class Gesture {
+	
+	public:
+		
+		static const byte NONE = 0;
+		static const byte TAP = 1; // A sequence of taps, see getTaps()
+		static const byte HOLD = 2; // Pressed for the hold duration
+		static const byte TAP_HOLD = 3; // Pressed for the hold duration after some taps, see getTaps()
+		
+		/**
+		 * Constructor
+		 */
+		void init() {
+			this->phase = IDLE;
+			this->taps = 0;
+			this->edgeMs = 0;
+		}
+		
+		/**
+		 * Handle a press edge at the given time, with the tap window in milliseconds
+		 */
+		void press(unsigned long ms, unsigned int tapMs) {
+			if (this->phase == IDLE || (this->phase == UP && (uint16_t)(ms - this->edgeMs) > tapMs)) {
+				this->taps = 0; // New sequence (a stale one is dropped if not polled in time)
+			}
+			this->phase = DOWN;
+			this->edgeMs = ms;
+		}
+		
+		/**
+		 * Handle a release edge at the given time
+		 */
+		void release(unsigned long ms) {
+			if (this->phase == DOWN) {
+				if (this->taps < 255) this->taps++;
+				this->phase = UP;
+				this->edgeMs = ms;
+			} else if (this->phase == HELD) {
+				this->phase = IDLE;
+			}
+		}
+		
+		/**
+		 * Return TRUE between a press and a release edge
+		 */
+		bool isDown() {
+			return this->phase == DOWN || this->phase == HELD;
+		}
+		
+		/**
+		 * Check the deadlines at the given time, returning a recognized gesture only once, or NONE
+		 */
+		byte poll(unsigned long ms, unsigned int tapMs, unsigned int holdMs) {
+			if (this->phase == DOWN) {
+				if ((uint16_t)(ms - this->edgeMs) >= holdMs) {
+					this->phase = HELD;
+					return this->taps > 0 ? TAP_HOLD : HOLD;
+				}
+			} else if (this->phase == UP) {
+				if ((uint16_t)(ms - this->edgeMs) > tapMs) {
+					this->phase = IDLE;
+					return TAP;
+				}
+			}
+			return NONE;
+		}
+		
+		/**
+		 * Return the number of taps of the last TAP or TAP_HOLD gesture
+		 */
+		byte getTaps() {
+			return this->taps;
+		}
+		
+	private:
+		
+		static const byte IDLE = 0;
+		static const byte DOWN = 1; // Pressed, waiting for the release or the hold duration
+		static const byte UP = 2; // Released after a tap, waiting for the tap window to expire
+		static const byte HELD = 3; // Hold reported, waiting for the release
+		
+		byte phase;
+		byte taps;
+		uint16_t edgeMs; // Time of the last edge, lower 16 bits
+		
+};
+
+#endif
@@ -0,0 +1,342 @@
+#ifndef ButtonBank_h
+#define ButtonBank_h
+
+#include "Arduino.h"
+
+#include "EdgeQueue.cpp"
+#include "Gesture.cpp"
+
+// Buttons debounced all at once (ATmega328P): on a fixed tick from the Timer0 compare B interrupt, which is free
+// alongside millis(), whole ports are sampled and debounced with vertical counters, i.e. a 2-bit counter for each pin
+// stored across two bytes and updated with a few bitwise operations for all the pins of a port. A pin changes state
+// after 4 equal samples in a row. Debounced edges are timestamped into a queue and recognized by a state machine
+// in the main loop, only when an edge arrives, so idle buttons cost nothing there.
+// Same reading methods of the Button class, with the button index as returned by add(), plus events as bitmasks.
+// Gestures are fed with the debounced edges, so that taps are counted even if the main loop is busy.
+
+#define BUTTON_BANK_SIZE 8
+#define BUTTON_BANK_NONE 255 // Returned by add() when the bank is full, never pressed
+
+class ButtonBank {
+	
+	public:
+		
+		/**
+		 * Add a button, returning its index, or BUTTON_BANK_NONE if the bank is full. Call this before start().
+		 */
+		static byte add(byte pin, bool invert = false, bool internalPullup = false) {
+			byte i = ButtonBank::count;
+			if (i == BUTTON_BANK_SIZE) return BUTTON_BANK_NONE;
+			pinMode(pin, internalPullup ? INPUT_PULLUP : INPUT);
+			byte port = digitalPinToPort(pin) - PB; // 0 for PORTB, 1 for PORTC, 2 for PORTD
+			byte mask = digitalPinToBitMask(pin);
+			ButtonBank::buttonPorts[i] = port;
+			ButtonBank::buttonMasks[i] = mask;
+			ButtonBank::portMasks[port] |= mask;
+			if (invert) ButtonBank::portInverted[port] |= mask; // Pressed pins are sampled as LOW
+			ButtonBank::count++;
+			return i;
+		}
+		
+		/**
+		 * Start sampling, specifying the debounce delay and the tap window for gestures (see readGesture()).
+		 * Buttons already pressed are handled as pressed right now.
+		 */
+		static void start(unsigned int debounceDelayMs, unsigned int tapMs = 0) {
+			ButtonBank::tapMs = tapMs;
+			ButtonBank::samplingTicks = constrain(debounceDelayMs / 4, 1, 255); // Ticks are 1.024 ms, close enough
+			ButtonBank::ticks = 0;
+			ButtonBank::edges.init();
+			uint8_t oldSREG = SREG;
+			cli();
+			for (byte p = 0; p < 3; p++) {
+				ButtonBank::count0[p] = 0xFF;
+				ButtonBank::count1[p] = 0xFF;
+				ButtonBank::debounced[p] = ButtonBank::sample(p);
+			}
+			for (byte i = 0; i < ButtonBank::count; i++) {
+				ButtonBank::flags[i] = 0;
+				ButtonBank::gestures[i].init();
+				if (ButtonBank::isPressed(i)) ButtonBank::edges.push(millis(), i | EDGE_PRESSED);
+			}
+			TIFR0 = _BV(OCF0B); // Clear any pending interrupt
+			TIMSK0 |= _BV(OCIE0B); // Fires once per Timer0 cycle whatever OCR0B is, so analogWrite() on pin 5 is fine
+			SREG = oldSREG;
+		}
+		
+		/**
+		 * Get the button state, TRUE if pressed (after debouncing)
+		 */
+		static bool read(byte i) {
+			if (i >= ButtonBank::count) return false;
+			ButtonBank::update();
+			return (ButtonBank::flags[i] & PRESSED) != 0;
+		}
+		
+		/**
+		 * Return TRUE only once for each press, even if the button has been released in the meanwhile
+		 */
+		static bool readOnce(byte i) {
+			if (i >= ButtonBank::count) return false;
+			ButtonBank::update();
+			if ((ButtonBank::flags[i] & ONCE) != 0) {
+				ButtonBank::flags[i] = (ButtonBank::flags[i] & ~ONCE) | HANDLED;
+				return true;
+			}
+			return false;
+		}
+		
+		/**
+		 * Detect button long press, TRUE if pressed for longer than given duration
+		 */
+		static bool readLongPress(byte i, unsigned long durationMs) {
+			return ButtonBank::read(i) && millis() - ButtonBank::pressMs[i] >= durationMs;
+		}
+		
+		/**
+		 * Same as readLongPress(), but returns TRUE only once, until the button is released
+		 */
+		static bool readLongPressOnce(byte i, unsigned long durationMs) {
+			if (ButtonBank::readLongPress(i, durationMs) && (ButtonBank::flags[i] & LONG_ONCE) == 0) {
+				ButtonBank::flags[i] |= LONG_ONCE;
+				return true;
+			}
+			return false;
+		}
+		
+		/*
+		 * A combined readOnce() and readLongPressOnce() for a multi-purpose button.
+		 * Returns 1 when the button is released before specified duration (short press).
+		 * Returns 2 as soon as the button has been pressed for specified duration.
+		 * Returns 0 in subsequent calls, while idle or while being pressed.
+		 */
+		static byte readShortOrLongPressOnce(byte i, unsigned long longPressDurationMs) {
+			if (i >= ButtonBank::count) return 0;
+			ButtonBank::update();
+			byte f = ButtonBank::flags[i];
+			if ((f & PRESSED) != 0) {
+				if ((f & HANDLED) == 0 && millis() - ButtonBank::pressMs[i] >= longPressDurationMs) {
+					ButtonBank::flags[i] = (f & ~ONCE) | HANDLED;
+					return 2;
+				}
+			} else if ((f & RELEASED) != 0) {
+				ButtonBank::flags[i] = f & ~(RELEASED | ONCE);
+				return ButtonBank::releaseMs[i] - ButtonBank::pressMs[i] >= longPressDurationMs ? 2 : 1;
+			}
+			return 0;
+		}
+		
+		/**
+		 * Recognize taps, holds and holds after taps (see Gesture), with the tap window given to start()
+		 * and the given hold duration. Returns a Gesture constant once for each gesture, or Gesture::NONE.
+		 */
+		static byte readGesture(byte i, unsigned int holdMs) {
+			if (i >= ButtonBank::count) return Gesture::NONE;
+			ButtonBank::update();
+			return ButtonBank::gestures[i].poll(millis(), ButtonBank::tapMs, holdMs);
+		}
+		
+		/**
+		 * Return the number of taps of the last gesture read by readGesture()
+		 */
+		static byte getTaps(byte i) {
+			return i < ButtonBank::count ? ButtonBank::gestures[i].getTaps() : 0;
+		}
+		
+		/**
+		 * Return the state of all the buttons as a bitmask, bit i set if button i is pressed
+		 */
+		static byte readAll() {
+			ButtonBank::update();
+			return ButtonBank::pressedMask;
+		}
+		
+		/**
+		 * Return a bitmask of the buttons pressed since the previous call
+		 */
+		static byte readPresses() {
+			ButtonBank::update();
+			byte mask = ButtonBank::pressEvents;
+			ButtonBank::pressEvents = 0;
+			return mask;
+		}
+		
+		/**
+		 * Return a bitmask of the buttons released since the previous call
+		 */
+		static byte readReleases() {
+			ButtonBank::update();
+			byte mask = ButtonBank::releaseEvents;
+			ButtonBank::releaseEvents = 0;
+			return mask;
+		}
+		
+		/**
+		 * Return a bitmask of the buttons pressed for longer than given duration, each one only once
+		 * until released (shared with readLongPressOnce())
+		 */
+		static byte readLongPresses(unsigned long durationMs) {
+			ButtonBank::update();
+			byte mask = 0;
+			unsigned long ms = millis();
+			for (byte i = 0; i < ButtonBank::count; i++) {
+				byte f = ButtonBank::flags[i];
+				if ((f & (PRESSED | LONG_ONCE)) == PRESSED && ms - ButtonBank::pressMs[i] >= durationMs) {
+					ButtonBank::flags[i] = f | LONG_ONCE;
+					mask |= _BV(i);
+				}
+			}
+			return mask;
+		}
+		
+		/**
+		 * Sample and debounce all the buttons, called from the timer interrupt
+		 */
+		static void isr() {
+			
+			if (++ButtonBank::ticks < ButtonBank::samplingTicks) return;
+			ButtonBank::ticks = 0;
+			
+			for (byte p = 0; p < 3; p++) {
+				if (ButtonBank::portMasks[p] == 0) continue;
+				
+				// Vertical counters: each pin counts the samples that differ from its debounced state,
+				// and it's reset as soon as a sample agrees. Pins whose counter expires are toggled.
+				byte delta = ButtonBank::sample(p) ^ ButtonBank::debounced[p];
+				byte c0 = ~(ButtonBank::count0[p] & delta);
+				byte c1 = c0 ^ (ButtonBank::count1[p] & delta);
+				ButtonBank::count0[p] = c0;
+				ButtonBank::count1[p] = c1;
+				byte toggled = delta & c0 & c1;
+				if (toggled == 0) continue;
+				ButtonBank::debounced[p] ^= toggled;
+				
+				// Timestamp the edges
+				unsigned long ms = millis();
+				for (byte i = 0; i < ButtonBank::count; i++) {
+					if (ButtonBank::buttonPorts[i] == p && (toggled & ButtonBank::buttonMasks[i]) != 0) {
+						ButtonBank::edges.push(ms, ButtonBank::isPressed(i) ? i | EDGE_PRESSED : i);
+					}
+				}
+				
+			}
+			
+		}
+		
+	private:
+		
+		static const byte EDGE_PRESSED = 0x80; // Edge value flag, the lower bits are the button index
+		
+		// Button state flags
+		static const byte PRESSED = 1; // Debounced state
+		static const byte ONCE = 2; // Press not read by readOnce() yet
+		static const byte HANDLED = 4; // Press already reported by some reading method
+		static const byte RELEASED = 8; // Press completed and not handled yet, i.e. a short press
+		static const byte LONG_ONCE = 16; // Long press already reported by readLongPressOnce()
+		
+		static byte count;
+		static byte buttonPorts[BUTTON_BANK_SIZE];
+		static byte buttonMasks[BUTTON_BANK_SIZE];
+		static unsigned int tapMs;
+		
+		// Sampling, by port (B, C, D), owned by the ISR
+		static byte portMasks[3];
+		static byte portInverted[3];
+		static byte samplingTicks;
+		static byte ticks;
+		static byte count0[3];
+		static byte count1[3];
+		static volatile byte debounced[3]; // Bit set for pressed buttons
+		
+		static EdgeQueue edges;
+		static unsigned int overflows; // Queue overflows already handled
+		
+		// Recognition, owned by the main loop
+		static byte flags[BUTTON_BANK_SIZE];
+		static unsigned long pressMs[BUTTON_BANK_SIZE];
+		static unsigned long releaseMs[BUTTON_BANK_SIZE];
+		static Gesture gestures[BUTTON_BANK_SIZE];
+		static byte pressedMask;
+		static byte pressEvents;
+		static byte releaseEvents;
+		
+		static byte sample(byte p) {
+			byte reading = p == 0 ? PINB : (p == 1 ? PINC : PIND);
+			return (reading ^ ButtonBank::portInverted[p]) & ButtonBank::portMasks[p];
+		}
+		
+		static bool isPressed(byte i) {
+			return (ButtonBank::debounced[ButtonBank::buttonPorts[i]] & ButtonBank::buttonMasks[i]) != 0;
+		}
+		
+		/**
+		 * Run the state machine on queued edges
+		 */
+		static void update() {
+			
+			unsigned long ms;
+			byte value;
+			if (!ButtonBank::edges.pop(ms, value)) return; // Idle, nothing else to do
+			do {
+				ButtonBank::edge(value & ~EDGE_PRESSED, (value & EDGE_PRESSED) != 0, ms);
+			} while (ButtonBank::edges.pop(ms, value));
+			
+			// Edges have been lost, take the debounced state to get back in sync. The queue must have been full,
+			// so this can only happen when there were edges to read.
+			unsigned int overflows = ButtonBank::edges.getOverflows();
+			if (overflows != ButtonBank::overflows) {
+				ButtonBank::overflows = overflows;
+				for (byte i = 0; i < ButtonBank::count; i++) {
+					ButtonBank::edge(i, ButtonBank::isPressed(i), millis());
+				}
+			}
+			
+		}
+		
+		static void edge(byte i, bool pressed, unsigned long ms) {
+			byte f = ButtonBank::flags[i];
+			if (pressed) {
+				if ((f & PRESSED) == 0) {
+					ButtonBank::pressMs[i] = ms;
+					ButtonBank::flags[i] = PRESSED | ONCE;
+					ButtonBank::pressedMask |= _BV(i);
+					ButtonBank::pressEvents |= _BV(i);
+					ButtonBank::gestures[i].press(ms, ButtonBank::tapMs);
+				}
+			} else if ((f & PRESSED) != 0) {
+				ButtonBank::releaseMs[i] = ms;
+				ButtonBank::flags[i] = (f & ~PRESSED) | ((f & HANDLED) == 0 ? RELEASED : 0);
+				ButtonBank::pressedMask &= ~_BV(i);
+				ButtonBank::releaseEvents |= _BV(i);
+				ButtonBank::gestures[i].release(ms);
+			}
+		}
+		
+};
+
+byte ButtonBank::count = 0;
+byte ButtonBank::buttonPorts[BUTTON_BANK_SIZE];
+byte ButtonBank::buttonMasks[BUTTON_BANK_SIZE];
+unsigned int ButtonBank::tapMs = 0;
+byte ButtonBank::portMasks[3] = { 0, 0, 0 };
+byte ButtonBank::portInverted[3] = { 0, 0, 0 };
+byte ButtonBank::samplingTicks = 1;
+byte ButtonBank::ticks = 0;
+byte ButtonBank::count0[3];
+byte ButtonBank::count1[3];
+volatile byte ButtonBank::debounced[3];
+EdgeQueue ButtonBank::edges;
+unsigned int ButtonBank::overflows = 0;
+byte ButtonBank::flags[BUTTON_BANK_SIZE];
+unsigned long ButtonBank::pressMs[BUTTON_BANK_SIZE];
+unsigned long ButtonBank::releaseMs[BUTTON_BANK_SIZE];
+Gesture ButtonBank::gestures[BUTTON_BANK_SIZE];
+byte ButtonBank::pressedMask = 0;
+byte ButtonBank::pressEvents = 0;
+byte ButtonBank::releaseEvents = 0;
+
+ISR(TIMER0_COMPB_vect) {
+	ButtonBank::isr();
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef FastRandom_h
+#define FastRandom_h
+
+#include "Arduino.h"
+#include <avr/wdt.h>
+
+// Xorshift pseudo-random generator by George Marsaglia. It needs no multiplication nor division,
+// so it's much faster than random() on AVR and can be called from ISRs. It's meant to be seeded only once,
+// possibly with hardware noise: reseeding from time makes outcomes correlated with the timing of the calls.
+
+class FastRandom {
+	
+	public:
+		
+		/**
+		 * Setup the generator with the given seed (zero is replaced, since the generator would be stuck)
+		 */
+		void init(unsigned long seed) {
+			this->state = seed != 0 ? seed : 0x9E3779B9UL;
+		}
+		
+		/**
+		 * Return 32 random bits
+		 */
+		unsigned long next() {
+			unsigned long x = this->state;
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			this->state = x;
+			return x;
+		}
+		
+		/**
+		 * Return TRUE with the given probability, as a fixed-point fraction of 65536 (0 for never, 65536 for always)
+		 */
+		bool chance(unsigned long probability) {
+			return (this->next() >> 16) < probability; // Higher bits, which are the most random
+		}
+		
+		/**
+		 * Collect a seed from the jitter between the watchdog oscillator and the system clock, mixed with the noise
+		 * of an analog input. It blocks for about 130 ms with interrupts disabled, so call it from setup() only.
+		 */
+		static unsigned long entropy(byte analogPin) {
+			
+			unsigned long seed = 0;
+			uint8_t oldSREG = SREG;
+			cli();
+			
+			// Watchdog in interrupt mode with the shortest timeout (16 ms), polled since interrupts are disabled
+			wdt_reset();
+			WDTCSR = _BV(WDCE) | _BV(WDE);
+			WDTCSR = _BV(WDIF) | _BV(WDIE);
+			
+			// Mix in every analog reading until the watchdog times out, then the Timer0 count at that moment:
+			// both the number of readings and the count vary with the two oscillators drift
+			for (byte i = 0; i < 8; i++) {
+				while ((WDTCSR & _BV(WDIF)) == 0) {
+					seed = ((seed << 1) | (seed >> 31)) ^ analogRead(analogPin);
+				}
+				WDTCSR = _BV(WDIF) | _BV(WDIE); // Clear the flag
+				seed = ((seed << 8) | (seed >> 24)) ^ TCNT0;
+			}
+			
+			// Stop the watchdog
+			WDTCSR = _BV(WDCE) | _BV(WDE);
+			WDTCSR = 0;
+			
+			SREG = oldSREG;
+			return seed;
+			
+		}
+		
+	private:
+		
+		unsigned long state;
+		
+};
+
+#endif
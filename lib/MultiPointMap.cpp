@@ -39,7 +39,7 @@ class MultiPointMap {
 		/**
 		 * Set the value of a fixed point
 		 */
-		uint16_t set(uint8_t i, uint16_t value) {
+		void set(uint8_t i, uint16_t value) {
 			this->points[i] = value;
 		}
 		
@@ -0,0 +1,100 @@
+#ifndef PeriodicTimer_h
+#define PeriodicTimer_h
+
+#include "Arduino.h"
+
+// Calls a function periodically from the compare match interrupt of the 16-bit Timer1 (ATmega328P),
+// so its timing is independent from the main loop load. Timer1 is also used by analogWrite() on
+// pins 9 and 10 and by the Servo library, which can't be used together with this class.
+
+class PeriodicTimer {
+	
+	public:
+		
+		/**
+		 * Setup the timer, specifying the function to call from the ISR
+		 */
+		static void init(void (*callback)()) {
+			PeriodicTimer::callback = callback;
+			PeriodicTimer::stop();
+		}
+		
+		/**
+		 * Start calling the function with the given period, up to about 4 seconds.
+		 * Optionally pretend the given time has already passed since the last call, to align the
+		 * timer with another signal: if it's longer than the period, the first call is immediate.
+		 */
+		static void start(unsigned long periodUs, unsigned long elapsedUs = 0) {
+			uint8_t oldSREG = SREG;
+			cli();
+			PeriodicTimer::configure(periodUs, elapsedUs);
+			TIFR1 = _BV(OCF1A); // Clear any pending interrupt
+			TIMSK1 = _BV(OCIE1A);
+			SREG = oldSREG;
+		}
+		
+		/**
+		 * Change the period while running, preserving the time elapsed since the last call
+		 */
+		static void setPeriod(unsigned long periodUs) {
+			uint8_t oldSREG = SREG;
+			cli();
+			unsigned long elapsedUs = ((unsigned long)TCNT1 << PeriodicTimer::prescalerShift) >> 4;
+			PeriodicTimer::configure(periodUs, elapsedUs);
+			SREG = oldSREG;
+		}
+		
+		/**
+		 * Stop the timer
+		 */
+		static void stop() {
+			TIMSK1 = 0;
+			TCCR1A = 0;
+			TCCR1B = 0;
+		}
+		
+		static void (*callback)();
+		
+	private:
+		
+		static byte prescalerShift; // The timer counts at F_CPU / 2^prescalerShift
+		
+		static void configure(unsigned long periodUs, unsigned long elapsedUs) {
+			
+			// Choose the smallest prescaler that fits the period in 16 bits, for the best resolution
+			unsigned long ticks = periodUs << 4; // Assuming a 16 MHz clock
+			byte cs;
+			if (ticks < (65536UL << 3)) {
+				prescalerShift = 3;
+				cs = _BV(CS11);
+			} else if (ticks < (65536UL << 6)) {
+				prescalerShift = 6;
+				cs = _BV(CS11) | _BV(CS10);
+			} else if (ticks < (65536UL << 8)) {
+				prescalerShift = 8;
+				cs = _BV(CS12);
+			} else {
+				prescalerShift = 10;
+				cs = _BV(CS12) | _BV(CS10);
+			}
+			ticks = min(ticks >> prescalerShift, 65536UL);
+			unsigned long elapsedTicks = min((elapsedUs << 4) >> prescalerShift, ticks - 2); // Writing TCNT1 blocks the next compare match
+			
+			// Clear timer on compare match (CTC) mode
+			TCCR1A = 0;
+			TCCR1B = _BV(WGM12) | cs;
+			OCR1A = ticks - 1;
+			TCNT1 = elapsedTicks;
+			
+		}
+		
+};
+
+void (*PeriodicTimer::callback)() = 0;
+byte PeriodicTimer::prescalerShift = 0;
+
+ISR(TIMER1_COMPA_vect) {
+	PeriodicTimer::callback();
+}
+
+#endif
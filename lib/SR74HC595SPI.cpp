@@ -0,0 +1,63 @@
+#ifndef SR74HC595SPI_h
+#define SR74HC595SPI_h
+
+#include "Arduino.h"
+#include <SPI.h>
+
+// Faster variant of SR74HC595 for a chain of LENGTH (up to 4) daisy-chained shift registers on the hardware SPI bus.
+// Connect MOSI (pin 11) to the serial data input (SER) of the first register, SCK (pin 13) to all the shift
+// register clocks (SCK), and any pin to all the storage register clocks (RCK). The serial output (QH') of
+// each register goes to the serial data input of the next one.
+
+template <byte LENGTH>
+class SR74HC595SPI {
+	
+	static_assert(LENGTH >= 1 && LENGTH <= 4, "Chain length must be between 1 and 4");
+	
+	public:
+		
+		/** 
+		 * Setup the chain interface, specifying the "latch pin" for the storage register clocks (RCK)
+		 */
+		void init(byte latchPin) {
+			
+			this->latchPort = portOutputRegister(digitalPinToPort(latchPin));
+			this->latchMask = digitalPinToBitMask(latchPin);
+			
+			pinMode(latchPin, OUTPUT);
+			SPI.begin();
+			
+		}
+		
+		/**
+		 * Writes 8 bits for each register of the chain, the lowest byte for the first register, and enables
+		 * the storage registers when finished (latch). Each byte is sent MSBFIRST, like SR74HC595::write().
+		 */
+		void write(unsigned long value) {
+			SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+			this->latch(false); // So the outputs don't change while sending in bits
+			for (byte i = LENGTH; i > 0; i--) {
+				SPI.transfer((byte)(value >> (8 * (i - 1)))); // The byte for the last register goes first
+			}
+			this->latch(true); // The outputs update at once
+			SPI.endTransaction();
+		}
+		
+	private:
+		volatile uint8_t* latchPort;
+		uint8_t latchMask;
+		
+		void latch(bool high) {
+			uint8_t oldSREG = SREG;
+			cli(); // The port could be written by an ISR too
+			if (high) {
+				*this->latchPort |= this->latchMask;
+			} else {
+				*this->latchPort &= ~this->latchMask;
+			}
+			SREG = oldSREG;
+		}
+		
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include "Arduino.h"
+
+// Cooperative scheduler for the periodic and delayed work of the main loop, instead of scattered millis() checks.
+// Each loop() call runs at most one task, the most urgent of the due ones: the highest priority first, then the
+// earliest deadline. The real-time work of the main loop (MIDI, clock edges) is then never delayed by more than a
+// single task. Periodic tasks don't drift, but skip the runs missed by more than a period instead of bursting.
+// Deadlines are compared by difference, so they survive the millis() overflow. The longest run of each task
+// is recorded, to find the ones worth splitting. While nothing is due, loop() is a single comparison.
+
+#define SCHEDULER_SIZE 8
+#define SCHEDULER_NONE 255 // Returned by add() when the table is full, ignored by the other methods
+
+class Scheduler {
+	
+	public:
+		
+		/**
+		 * Add a task calling the given function every period in milliseconds, starting after a period, or a
+		 * one-shot task if the period is zero, to be started later. Higher priorities run first.
+		 * Returns the index of the task, or SCHEDULER_NONE if the table is full.
+		 */
+		static byte add(void (*function)(), unsigned long periodMs, byte priority = 0) {
+			byte i = Scheduler::count;
+			if (i == SCHEDULER_SIZE) return SCHEDULER_NONE;
+			Scheduler::functions[i] = function;
+			Scheduler::periodMs[i] = periodMs;
+			Scheduler::priority[i] = priority;
+			Scheduler::maxRunUs[i] = 0;
+			Scheduler::count++;
+			if (periodMs > 0) Scheduler::start(i, periodMs);
+			return i;
+		}
+		
+		/**
+		 * Run the task after the given delay in milliseconds, then every period if it's periodic.
+		 * If already started, the deadline is moved. A task can restart itself while running.
+		 */
+		static void start(byte i, unsigned long delayMs) {
+			if (i >= Scheduler::count) return;
+			Scheduler::deadlineMs[i] = millis() + delayMs;
+			Scheduler::started |= 1 << i;
+			Scheduler::updateNext();
+		}
+		
+		/**
+		 * Stop the task, that won't run until started again
+		 */
+		static void stop(byte i) {
+			if (i >= Scheduler::count) return;
+			Scheduler::started &= ~(1 << i);
+			Scheduler::updateNext();
+		}
+		
+		/**
+		 * Return TRUE if the task is waiting for its deadline
+		 */
+		static bool isStarted(byte i) {
+			return i < Scheduler::count && (Scheduler::started & (1 << i)) != 0;
+		}
+		
+		/**
+		 * Return the number of tasks
+		 */
+		static byte getCount() {
+			return Scheduler::count;
+		}
+		
+		/**
+		 * Return the longest run of the task, in microseconds
+		 */
+		static unsigned int getMaxRunUs(byte i) {
+			return i < Scheduler::count ? Scheduler::maxRunUs[i] : 0;
+		}
+		
+		/**
+		 * Run the most urgent due task, if any, returning TRUE if it did
+		 */
+		static bool loop() {
+			
+			if (Scheduler::started == 0) return false;
+			unsigned long ms = millis();
+			if ((long)(ms - Scheduler::nextMs) < 0) return false;
+			
+			// Pick the due task with the highest priority, then the earliest deadline
+			byte t = SCHEDULER_SIZE;
+			for (byte i = 0; i < Scheduler::count; i++) {
+				if ((Scheduler::started & (1 << i)) == 0 || (long)(ms - Scheduler::deadlineMs[i]) < 0) continue;
+				if (t == SCHEDULER_SIZE || Scheduler::priority[i] > Scheduler::priority[t] || (
+					Scheduler::priority[i] == Scheduler::priority[t] &&
+					(long)(Scheduler::deadlineMs[i] - Scheduler::deadlineMs[t]) < 0
+				)) {
+					t = i;
+				}
+			}
+			if (t == SCHEDULER_SIZE) return false;
+			
+			// Set the next deadline before running, so that the task can restart or stop itself
+			if (Scheduler::periodMs[t] > 0) {
+				Scheduler::deadlineMs[t] += Scheduler::periodMs[t];
+				if ((long)(ms - Scheduler::deadlineMs[t]) >= 0) {
+					Scheduler::deadlineMs[t] = ms + Scheduler::periodMs[t]; // Late by more than a period
+				}
+			} else {
+				Scheduler::started &= ~(1 << t);
+			}
+			
+			unsigned long startUs = micros();
+			Scheduler::functions[t]();
+			unsigned long runUs = micros() - startUs;
+			if (runUs > Scheduler::maxRunUs[t]) Scheduler::maxRunUs[t] = min(runUs, 65535UL);
+			
+			Scheduler::updateNext();
+			return true;
+			
+		}
+		
+	private:
+		
+		static byte count;
+		static void (*functions[SCHEDULER_SIZE])();
+		static unsigned long periodMs[SCHEDULER_SIZE];
+		static unsigned long deadlineMs[SCHEDULER_SIZE];
+		static byte priority[SCHEDULER_SIZE];
+		static unsigned int maxRunUs[SCHEDULER_SIZE];
+		static byte started; // Bit i for task i
+		static unsigned long nextMs; // Earliest deadline of the started tasks
+		
+		static void updateNext() {
+			bool first = true;
+			for (byte i = 0; i < Scheduler::count; i++) {
+				if ((Scheduler::started & (1 << i)) == 0) continue;
+				if (first || (long)(Scheduler::deadlineMs[i] - Scheduler::nextMs) < 0) {
+					Scheduler::nextMs = Scheduler::deadlineMs[i];
+					first = false;
+				}
+			}
+		}
+		
+};
+
+byte Scheduler::count = 0;
+void (*Scheduler::functions[SCHEDULER_SIZE])();
+unsigned long Scheduler::periodMs[SCHEDULER_SIZE];
+unsigned long Scheduler::deadlineMs[SCHEDULER_SIZE];
+byte Scheduler::priority[SCHEDULER_SIZE];
+unsigned int Scheduler::maxRunUs[SCHEDULER_SIZE];
+byte Scheduler::started = 0;
+unsigned long Scheduler::nextMs = 0;
+
+#endif
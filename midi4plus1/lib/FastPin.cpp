@@ -0,0 +1,109 @@
+#ifndef FastPin_h
+#define FastPin_h
+
+#include "Arduino.h"
+
+// Direct port access for pins known at compile time, on the ATmega328P (Uno, Nano).
+// The port and bit of a pin are resolved by the compiler, so that each operation is a single sbi, cbi or in
+// instruction instead of the table lookups of digitalWrite() and digitalRead(). Only digital pins 0-13 and
+// A0-A5 are supported, as A6 and A7 of the Nano are analog inputs only.
+// For pins from configuration arrays, indexed at runtime, cache the registers and bit masks instead.
+
+/**
+ * Return the port of a pin: 0 for port B, 1 for port C and 2 for port D, as digitalPinToPort(pin) - PB
+ */
+constexpr byte fastPinPort(byte pin) {
+	return pin < 8 ? 2 : (pin < 14 ? 0 : 1);
+}
+
+/**
+ * Return the bit mask of a pin in its port, as digitalPinToBitMask(pin)
+ */
+constexpr byte fastPinMask(byte pin) {
+	return 1 << (pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14));
+}
+
+template <byte PIN> class FastPin {
+	
+	static_assert(PIN < 20, "FastPin supports digital pins 0-13 and A0-A5 only");
+	
+	public:
+		
+		static const byte PORT = fastPinPort(PIN);
+		static const byte MASK = fastPinMask(PIN);
+		
+		/**
+		 * Set the pin as output
+		 */
+		static inline void output() {
+			ddr() |= MASK;
+		}
+		
+		/**
+		 * Set the pin as input, with the internal pull-up resistor if required
+		 */
+		static inline void input(bool pullup = false) {
+			ddr() &= ~MASK;
+			if (pullup) {
+				out() |= MASK;
+			} else {
+				out() &= ~MASK;
+			}
+		}
+		
+		/**
+		 * Set the output high
+		 */
+		static inline void high() {
+			out() |= MASK;
+		}
+		
+		/**
+		 * Set the output low
+		 */
+		static inline void low() {
+			out() &= ~MASK;
+		}
+		
+		/**
+		 * Set the output high or low
+		 */
+		static inline void write(bool value) {
+			if (value) {
+				high();
+			} else {
+				low();
+			}
+		}
+		
+		/**
+		 * Invert the output, by writing to the input register
+		 */
+		static inline void toggle() {
+			in() = MASK;
+		}
+		
+		/**
+		 * Return TRUE if the pin is high
+		 */
+		static inline bool read() {
+			return (in() & MASK) != 0;
+		}
+		
+	private:
+		
+		static inline volatile uint8_t& out() {
+			return PORT == 0 ? PORTB : (PORT == 1 ? PORTC : PORTD);
+		}
+		
+		static inline volatile uint8_t& ddr() {
+			return PORT == 0 ? DDRB : (PORT == 1 ? DDRC : DDRD);
+		}
+		
+		static inline volatile uint8_t& in() {
+			return PORT == 0 ? PINB : (PORT == 1 ? PINC : PIND);
+		}
+		
+};
+
+#endif
@@ -6,7 +6,7 @@
 
 const byte MODE_BUTTON = A0; // Main button pin
 const byte MODE_LEDS[] = { A1, A2, A3 }; // RGB LED pins for current mode display
-const bool MODE_LEDS_PWM = true; // Set to FALSE to disable SoftPWM and adjust RGB brightness with resistors only 
+const bool MODE_LEDS_PWM = true; // Set to FALSE to disable PWM (Timer2) and adjust RGB brightness with resistors only
 
 const byte GATES[] { 3, 4, 5, 6 }; // Gate 1-4 pins
 const byte GATE_OR = 7; // Auxiliary gate pin, high when at least one gate is high
@@ -48,13 +48,14 @@ const bool DEBUG_WITH_TTYMIDI = false; // TRUE to use ttymidi bridge and print m
 
 #include <EEPROM.h>
 #include <MIDI.h>
-#include <SoftPWM.h>
 #include <Wire.h>
 
-#include "lib/Button.cpp"
-#include "lib/Led.cpp"
+#include "lib/ButtonBank.cpp"
+#include "lib/FastPin.cpp"
+#include "lib/LedBank.cpp"
 #include "lib/MCP4728.cpp"
 #include "lib/MultiPointMap.cpp"
+#include "lib/Scheduler.cpp"
 
 #include "mono.cpp"
 #include "poly.cpp"
@@ -75,12 +76,18 @@ const bool DEBUG_WITH_TTYMIDI = false; // TRUE to use ttymidi bridge and print m
 
 #define CALIBRATION_RGB 0x3333CC // White
 
-Button modeButton;
+byte modeButton; // Index in the ButtonBank
 MCP4728 dac;
 MultiPointMap calibration[4];
-Led gateLed[N];
-Led gateOrLed;
-Led noteOnLed;
+byte gateLed[N]; // Indexes in the LedBank
+byte gateOrLed;
+byte noteOnLed;
+byte modeLeds[3];
+volatile uint8_t* gateRegister[N]; // Output register of each gate, faster than digitalWrite()
+byte gateMask[N];
+byte clockTrigTask; // Indexes in the Scheduler
+byte voiceLockLedTask;
+byte calibrationTask;
 
 NoteStack mono[N];
 VoiceAllocator poly;
@@ -90,14 +97,11 @@ byte voiceMidiNote[N]; // Current MIDI note for each voice
 bool voiceActive[N]; // Current activation state for each voice
 unsigned long voiceRetrigTime[N]; // Time the retrig interval started, zero if retrig is not occurring
 bool voiceLocked[N]; // TRUE if the voice is currently locked
-unsigned long voiceLockLedTime = 0; // Time the mode LED has been turned off to signal lock
 int pitchBend; // Pitch-bend value (all voices in poly modes, monophonic voice only in split modes)
 bool outputFlag; // TRUE if it's necessary to update the outputs
 
 unsigned int clockCount = 0; // MIDI clock PPQ counter
 bool clockRunning = false; // TRUE if MIDI start/continue message has been received
-bool clockTrig = false; // TRUE if the trigger for the clock output is currently HIGH
-unsigned long clockTrigTime = 0; // Time of the last trigger for the clock output, in ms
 unsigned long clockTrigDuration = CLOCK_TRIG_MS; // Trigger width for the clock output signal, in ms
 
 bool calibrating = false; // TRUE if currently running the calibration process
@@ -135,23 +139,20 @@ void setup() {
 	}
 	
 	// Setup I/O
-	modeButton.init(MODE_BUTTON, BUTTON_DEBOUNCE_DELAY, true, true);
-	pinMode(GATE_OR, OUTPUT);
-	gateOrLed.init(GATE_OR_LED, LED_MIN_DURATION_MS);
-	noteOnLed.init(NOTE_ON_LED, LED_MIN_DURATION_MS);
+	modeButton = ButtonBank::add(MODE_BUTTON, true, true);
+	FastPin<GATE_OR>::output();
+	gateOrLed = LedBank::add(GATE_OR_LED, LED_MIN_DURATION_MS);
+	noteOnLed = LedBank::add(NOTE_ON_LED, LED_MIN_DURATION_MS);
 	for (byte i = 0; i < N; i++) {
 		pinMode(GATES[i], OUTPUT);
-		gateLed[i].init(GATES_LEDS[i]);
+		gateRegister[i] = portOutputRegister(digitalPinToPort(GATES[i]));
+		gateMask[i] = digitalPinToBitMask(GATES[i]);
+		gateLed[i] = LedBank::add(GATES_LEDS[i]);
 	}
 	
 	// Setup mode RGB LED
-	if (MODE_LEDS_PWM) {
-		SoftPWMBegin(); // Software PWM for the mode RGB LED
-	} else {
-		pinMode(MODE_LEDS[0], OUTPUT);
-		pinMode(MODE_LEDS[1], OUTPUT);
-		pinMode(MODE_LEDS[2], OUTPUT);
-	}
+	for (byte c = 0; c < 3; c++) modeLeds[c] = LedBank::add(MODE_LEDS[c]);
+	if (MODE_LEDS_PWM) LedBank::startPwm(); // Hardware timer PWM for the mode RGB LED
 	
 	// Init I2C communication and DAC
 	Wire.begin();
@@ -170,7 +171,8 @@ void setup() {
 	
 	// If mode button is pressed on boot, start calibration process
 	delay(100);
-	if (modeButton.readOnce()) {
+	ButtonBank::start(BUTTON_DEBOUNCE_DELAY);
+	if (ButtonBank::readOnce(modeButton)) {
 		setupCalibration();
 	} else {
 		setupMain();
@@ -189,6 +191,11 @@ void setupMain() {
 	
 	bootAnimation();
 	
+	// Timeouts of the clock trigger, before anything else, and of the mode LED turned off to signal lock
+	clockTrigTask = Scheduler::add(clockTrigEnd, 0, 1);
+	voiceLockLedTask = Scheduler::add(setModeLed, 0);
+	if (DEBUG) Scheduler::add(debugTasks, 4000);
+	
 	// Calculate appropriate trigger width for the clock output signal
 	if (CLOCK) {
 		unsigned long clockMaxBPM = 600;
@@ -198,7 +205,7 @@ void setupMain() {
 	
 	// Set minimum "on" duration on gate LEDs
 	for (byte i = 0; i < N; i++) {
-		gateLed[i].setMinDurationMs(LED_MIN_DURATION_MS);
+		LedBank::setMinDurationMs(gateLed[i], LED_MIN_DURATION_MS);
 	}
 	
 	// Init mode from permanent storage
@@ -227,6 +234,7 @@ void setupCalibration() {
 	calibratingInterval = 0;
 	calibratingAddress = DAC_CALIBRATION_EEPROM_ADDRESS;
 	setModeLedColor(CALIBRATION_RGB);
+	calibrationTask = Scheduler::add(calibrationUpdate, 50);
 	
 	// MIDI callback
 	MIDI.setHandleNoteOn(handleCalibrationOffset);
@@ -243,10 +251,9 @@ void loop() {
 		loopMain();
 	}
 	
-	// Update LEDs
-	gateOrLed.loop();
-	noteOnLed.loop();
-	for (byte i = 0; i < N; i++) gateLed[i].loop();
+	// Timeouts and periodic updates, then LEDs
+	Scheduler::loop();
+	LedBank::loop();
 	
 }
 
@@ -268,34 +275,20 @@ void loopMain() {
 		outputFlag = false;
 	}
 	
-	// Update clock output
-	if (CLOCK) {
-		if (clockTrig && (clockTrigTime + clockTrigDuration < millis())) {
-			digitalWrite(GATE_OR, LOW);
-			clockTrig = false;
-		}
-	}
-	
 	// Check for mode button presses
-	byte modeButtonPress = modeButton.readShortOrLongPressOnce(BUTTON_LOCK_LONG_PRESS_MS);
+	byte modeButtonPress = ButtonBank::readShortOrLongPressOnce(modeButton, BUTTON_LOCK_LONG_PRESS_MS);
 	if (modeButtonPress == 1) {
 		setMode((mode + 1) % 5); // Short-press: cycle through modes
 	} else if (modeButtonPress == 2) {
 		voicesLock(); // Long-press: lock voices
 	}
 	
-	// Re-set mode LED if necessary
-	if (voiceLockLedTime > 0 && voiceLockLedTime + LED_MODE_LOCK_DURATION_MS < millis()) {
-		voiceLockLedTime = 0;
-		setModeLed();
-	}
-	
 }
 
 void loopCalibration() {
 	
 	// Button advance through calibration points and voices
-	if (modeButton.readOnce()) {
+	if (ButtonBank::readOnce(modeButton)) {
 		calibratingInterval++;
 		if (calibratingInterval == calibration[calibratingVoice].size()) {
 			
@@ -307,8 +300,9 @@ void loopCalibration() {
 			// Calibration completed?
 			if (calibratingVoice == N || calibratingVoice == 4) {
 				calibrating = false;
-				for (byte i = 0; i < N; i++) gateLed[i].off();
+				for (byte i = 0; i < N; i++) LedBank::off(gateLed[i]);
 				setModeLedColor(0x000000);
+				Scheduler::stop(calibrationTask);
 				delay(1000);
 				setupMain();
 				return;
@@ -319,27 +313,27 @@ void loopCalibration() {
 	
 	// Show which voice is currently being calibrated
 	for (byte i = 0; i < N; i++) {
-		gateLed[i].set(i == calibratingVoice);
+		LedBank::set(gateLed[i], i == calibratingVoice);
 	}
 	
-	if (millis() % 50 == 0) {
-		
-		// Update DAC values
-		unsigned int size = calibration[calibratingVoice].size();
-		unsigned int step = calibration[calibratingVoice].getStep();
-		unsigned int value = step * (calibratingInterval + 1);
-		dac.analogWrite(
-			calibration[0].map(calibratingVoice == 0 ? value : (calibratingVoice > 0 ? step * size : 0)), 
-			calibration[1].map(calibratingVoice == 1 ? value : (calibratingVoice > 1 ? step * size : 0)), 
-			calibration[2].map(calibratingVoice == 2 ? value : (calibratingVoice > 2 ? step * size : 0)), 
-			calibration[3].map(calibratingVoice == 3 ? value : (calibratingVoice > 3 ? step * size : 0))
-		);
-		
-		// Update gates
-		for (byte i = 0; i < N; i++) {
-			digitalWrite(GATES[i], calibratingVoice == i);
-		}
-		
+}
+
+void calibrationUpdate() {
+	
+	// Update DAC values
+	unsigned int size = calibration[calibratingVoice].size();
+	unsigned int step = calibration[calibratingVoice].getStep();
+	unsigned int value = step * (calibratingInterval + 1);
+	dac.analogWrite(
+		calibration[0].map(calibratingVoice == 0 ? value : (calibratingVoice > 0 ? step * size : 0)), 
+		calibration[1].map(calibratingVoice == 1 ? value : (calibratingVoice > 1 ? step * size : 0)), 
+		calibration[2].map(calibratingVoice == 2 ? value : (calibratingVoice > 2 ? step * size : 0)), 
+		calibration[3].map(calibratingVoice == 3 ? value : (calibratingVoice > 3 ? step * size : 0))
+	);
+	
+	// Update gates
+	for (byte i = 0; i < N; i++) {
+		writeGate(i, calibratingVoice == i);
 	}
 	
 }
@@ -398,16 +392,8 @@ void voicesLock() {
 		}
 		
 		// Turn off the mode LED to signal (un)locking
-		voiceLockLedTime = millis();
-		if (MODE_LEDS_PWM) {
-			SoftPWMSet(MODE_LEDS[0], 0);
-			SoftPWMSet(MODE_LEDS[1], 0);
-			SoftPWMSet(MODE_LEDS[2], 0);
-		} else {
-			digitalWrite(MODE_LEDS[0], LOW);
-			digitalWrite(MODE_LEDS[1], LOW);
-			digitalWrite(MODE_LEDS[2], LOW);
-		}
+		setModeLedColor(0x000000);
+		Scheduler::start(voiceLockLedTask, LED_MODE_LOCK_DURATION_MS);
 		
 	}
 	
@@ -417,14 +403,14 @@ void reset() {
 	
 	// Reset gates; CVs don't need reset, they'll keep the last note value and that's fine
 	for (byte i = 0; i < N; i++) {
-		digitalWrite(GATES[i], LOW);
-		gateLed[i].off();
+		writeGate(i, false);
+		LedBank::off(gateLed[i]);
 		voiceActive[i] = false;
 		voiceLocked[i] = false;
 		voiceRetrigTime[i] = 0;
 	}
-	digitalWrite(GATE_OR, LOW);
-	gateOrLed.off();
+	FastPin<GATE_OR>::low();
+	LedBank::off(gateOrLed);
 	
 	// Reset allocators
 	for (byte i = 0; i < N; i++) {
@@ -462,8 +448,8 @@ void output() {
 	// Update gates
 	for (byte i = 0; i < N; i++) {
 		bool active = voiceActive[i] && voiceRetrigTime[i] == 0;
-		digitalWrite(GATES[i], active);
-		gateLed[i].set(active);
+		writeGate(i, active);
+		LedBank::set(gateLed[i], active);
 	}
 	
 	// Update OR gate
@@ -474,14 +460,25 @@ void output() {
 		for (byte i = gateOrFirstVoice; i <= gateOrLastVoice; i++) {
 			gateOrActive |= voiceActive[i];
 		}
-		digitalWrite(GATE_OR, gateOrActive);
-		gateOrLed.set(gateOrActive);
+		FastPin<GATE_OR>::write(gateOrActive);
+		LedBank::set(gateOrLed, gateOrActive);
 	}
 	
 	if (DEBUG) debugVoices();
 	
 }
 
+void writeGate(byte i, bool active) {
+	byte sreg = SREG;
+	cli(); // As in digitalWrite(), LEDs may share the port and be written from the PWM interrupt
+	if (active) {
+		*gateRegister[i] |= gateMask[i];
+	} else {
+		*gateRegister[i] &= ~gateMask[i];
+	}
+	SREG = sreg;
+}
+
 void setModeLed() {
 	switch (mode) {
 		case MODE_POLY: setModeLedColor(MODE_POLY_RGB); break;
@@ -493,19 +490,15 @@ void setModeLed() {
 }
 
 void setModeLedColor(unsigned long color) {
-	if (MODE_LEDS_PWM) {
-		SoftPWMSet(MODE_LEDS[0], (color >> 16) & 0xFF);
-		SoftPWMSet(MODE_LEDS[1], (color >> 8) & 0xFF);
-		SoftPWMSet(MODE_LEDS[2], color & 0xFF);
-	} else {
-		digitalWrite(MODE_LEDS[0], (color >> 16) & 0xFF ? HIGH : LOW);
-		digitalWrite(MODE_LEDS[1], (color >> 8) & 0xFF ? HIGH : LOW);
-		digitalWrite(MODE_LEDS[2], color & 0xFF ? HIGH : LOW);
+	for (byte c = 0; c < 3; c++) {
+		byte value = (color >> (16 - 8 * c)) & 0xFF;
+		LedBank::setBrightness(modeLeds[c], value); // Ignored without PWM
+		LedBank::set(modeLeds[c], value > 0);
 	}
 }
 
 void handleNoteOn(byte channel, byte note, byte velocity) {
-	noteOnLed.flash();
+	LedBank::flash(noteOnLed);
 	if (isNoteForMonophony(note)) {
 		if (mode == MODE_MONO && (channel == 0 || channel > N)) return;
 		mono[getMonophonyStackIndex(channel)].noteOn(note);
@@ -566,15 +559,18 @@ void handlePitchBend(byte channel, int bend) {
 void handleClock() {
 	if (clockRunning) {
 		if (clockCount == 0) {
-			digitalWrite(GATE_OR, HIGH);
-			clockTrig = true;
-			clockTrigTime = millis();
-			gateOrLed.flash();
+			FastPin<GATE_OR>::high();
+			Scheduler::start(clockTrigTask, clockTrigDuration);
+			LedBank::flash(gateOrLed);
 		}
 		clockCount = (clockCount + 1) % CLOCK_PPQ;
 	}
 }
 
+void clockTrigEnd() {
+	FastPin<GATE_OR>::low();
+}
+
 void handleStart() {
 	clockCount = 0;
 	clockRunning = true;
@@ -594,8 +590,8 @@ void handleSongPosition(unsigned int beats) {
 
 void handleCalibrationOffset(byte channel, byte note, byte velocity) {
 	if (calibrating) {
-		noteOnLed.flash();
-		gateOrLed.flash();
+		LedBank::flash(noteOnLed);
+		LedBank::flash(gateOrLed);
 		int offset = note >= (4 + 1) * 12 ? 1 : -1; // Split the keyboard in half on middle C
 		int v = calibration[calibratingVoice].get(calibratingInterval); // Current point value
 		calibration[calibratingVoice].set(calibratingInterval, max(0, v + offset)); // Move current point
@@ -676,24 +672,39 @@ void debugVoices() {
 	}
 }
 
+void debugTasks() {
+	if (DEBUG) {
+		String m = String("Max task times:");
+		for (byte i = 0; i < Scheduler::getCount(); i++) {
+			m.concat(" ");
+			m.concat(Scheduler::getMaxRunUs(i));
+		}
+		m.concat(" us");
+		debug(m);
+	}
+}
+
 void bootAnimation() {
 	
 	// Turn on all LEDs
 	for (byte i = 0; i < N; i++) {
-		gateLed[i].on();
+		LedBank::on(gateLed[i]);
+		LedBank::loop();
 		delay(100);
 	}
-	gateOrLed.on();
+	LedBank::on(gateOrLed);
+	LedBank::loop();
 	delay(200);
 	
 	// Turn them off
 	for (byte i = 0; i < N; i++) {
-		gateLed[i].off();
+		LedBank::off(gateLed[i]);
+		LedBank::loop();
 		delay(100);
 	}
-	gateOrLed.off();
+	LedBank::off(gateOrLed);
 	delay(100);
-	gateOrLed.loop();
+	LedBank::loop();
 	delay(200);
 	
 }
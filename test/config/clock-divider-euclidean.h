@@ -0,0 +1,60 @@
+// Configuration of clock-divider for test_clock-divider-euclidean: the default Euclidean rhythms, which must match
+// the table of fixed patterns they replaced
+
+// CONFIGURATION =============================================================
+
+const bool DEBUG = false; // FALSE to disable debug messages on serial port
+
+const int CLOCK_LED = 1; // LED pin for input signal indication
+const int CLOCK_INPUT = 2; // Input signal pin, must be usable for interrupts
+const int RESET_INPUT = 3; // Reset signal pin, must be usable for interrupts
+const int RESET_BUTTON = 4; // Reset button pin
+const int RANDOM_SEED_INPUT = A6; // Unconnected analog input, whose noise seeds the probabilities
+
+const int DIVISIONS[] { 2, 3, 4, 5, 6, 8, 16, 32 }; // Integer divisions of the input clock (max 32 values, the clock LED is disabled with 32), negative for multiplications
+const int DIVISIONS_OUTPUT[] { 5, 6, 7, 8, 9, 10, 11, 12 }; // Output pins
+const int DIVISIONS_LEDS[] { 0, A5, A4, A3, A2, A1, A0, 13 }; // LEDs pins
+
+const unsigned long MODE_SWITCH_LONG_PRESS_DURATION_MS = 3000; // Reset button long-press duration for trig/gate mode switch
+const unsigned long BUTTON_DEBOUNCE_DELAY = 50; // Debounce delay for all buttons
+const unsigned long LED_MIN_DURATION_MS = 50; // Minimum "on" duration for all LEDs visibility
+
+// TRUE to use the module as a frequency divider on audio-rate inputs (sub-octave generator).
+// Use it in gate mode to get square waves. Output LEDs and debugging are disabled to keep clock edges processing fast.
+const bool HIGH_RATE = false;
+
+// Swing and ratchets of each output, scheduled from a timer on the input clock period (not available in high-rate mode).
+// Swing delays every other pulse by a percentage of the divided period (0 to 50), ratchets split each pulse into
+// a number of shorter pulses (1 for none), evenly spaced in what remains of the divided period.
+const byte SWING[] { 0, 0, 0, 0, 0, 0, 0, 0 };
+const byte RATCHETS[] { 1, 1, 1, 1, 1, 1, 1, 1 };
+const unsigned long SCHEDULER_TICK_US = 100; // Resolution of swung, ratcheted and multiplied pulses
+const unsigned long CLOCK_MIN_PERIOD_US = 1000; // Shorter input clock periods are rejected as bounces when measured
+
+// Probability and logic of each output. Each pulse fires with a probability in percent, and logic outputs combine
+// the divisions of two other outputs (numbered from 0) instead of following their own: '&' for AND, '|' for OR,
+// '^' for XOR, e.g. { '^', 0, 1 } (0 for a plain division). Both are ignored on multiplied outputs and in high-rate mode.
+const byte PROBABILITY[] { 100, 100, 100, 100, 100, 100, 100, 100 };
+const char LOGIC[][3] {
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+	{ 0, 0, 0 },
+};
+
+const bool EUCLIDEAN = true; // TRUE to enable 8 channels of Euclidean rhythms
+const byte EUCLIDEAN_RHYTHMS[][3] { // Steps (up to 32), pulses (up to the steps) and rotation to the left of each channel
+	{ 8, 1, 0 },
+	{ 8, 2, 0 },
+	{ 8, 3, 0 },
+	{ 8, 4, 0 },
+	{ 8, 5, 3 },
+	{ 8, 6, 1 },
+	{ 8, 7, 1 },
+	{ 8, 8, 0 },
+};
+
@@ -0,0 +1,36 @@
+#!/bin/sh
+
+# SKETCH TO C++ ===============================================================
+#
+# Convert an Arduino sketch to a C++ file as the Arduino IDE does: include
+# Arduino.h first, then declare every function after the last #include line,
+# so that functions can be called before their definition. If a configuration
+# file is given, it replaces the configuration section at the top of the sketch,
+# up to its closing line of equal signs, to test other settings.
+#
+# Usage: test/ino2cpp.sh <sketch.ino> <output.cpp> [configuration.h]
+#
+# ============================================================================
+
+ino="$1"
+out="$2"
+config="$3"
+
+last=$(grep -n '^#include' "$ino" | tail -n 1 | cut -d: -f1)
+first=1
+if [ -n "$config" ]; then
+	first=$(grep -n '^// =====' "$ino" | head -n 1 | cut -d: -f1)
+fi
+
+{
+	echo '#include "Arduino.h"'
+	if [ -n "$config" ]; then
+		echo "#line 1 \"$config\""
+		cat "$config"
+	fi
+	echo "#line $first \"$ino\""
+	sed -n "${first},${last}p" "$ino"
+	grep -E '^[a-zA-Z_][a-zA-Z0-9_<>:* ]+ [a-zA-Z_][a-zA-Z0-9_]*\([^;{]*\) *\{' "$ino" | sed 's/ *{ *$/;/'
+	echo "#line $((last + 1)) \"$ino\""
+	tail -n +"$((last + 1))" "$ino"
+} > "$out"
@@ -0,0 +1,428 @@
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "SPI.h"
+#include "Wire.h"
+
+volatile uint8_t SREG = 0x80;
+
+volatile uint8_t PORTB, PORTC, PORTD;
+volatile uint8_t PINB, PINC, PIND;
+volatile uint8_t DDRB, DDRC, DDRD;
+
+volatile uint8_t TCCR0A, TCCR0B, TIMSK0, TIFR0, TCNT0, OCR0A, OCR0B;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+volatile uint8_t TCCR2A, TCCR2B, TIMSK2, TIFR2, TCNT2, OCR2A, OCR2B;
+
+volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR0;
+volatile uint16_t ADC;
+
+volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+volatile uint8_t EIMSK, EICRA;
+volatile uint8_t WDTCSR, MCUSR;
+volatile uint8_t SPCR, SPSR, SPDR;
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+SPIClass SPI;
+TwoWire Wire;
+
+// Interrupt handlers, defined by the libraries that use them
+extern "C" void TIMER0_COMPB_vect(void) __attribute__((weak));
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+extern "C" void ADC_vect(void) __attribute__((weak));
+
+static const unsigned int CYCLES_PER_US = F_CPU / 1000000UL;
+static const unsigned int ANALOG_READ_US = 112; // 13 ADC cycles at 125 kHz, plus overhead
+static const unsigned int WATCHDOG_US = 16000; // Shortest watchdog timeout
+
+static uint64_t now = 0; // In CPU cycles
+static uint64_t watchdogStart = 0;
+static int analogValues[8];
+static void (*interruptCallbacks[2])();
+static int interruptModes[2];
+
+// Timer1 and Timer2 run in clear timer on compare match mode: the count is kept in the registers,
+// the cycles of the prescaler not making a whole count yet are kept here
+static uint64_t timer1Start = 0;
+static uint64_t timer2Start = 0;
+
+// Free-running ADC: the input is selected when each conversion starts, the next one starting right away
+static uint64_t adcStart = 0;
+static bool adcRunning = false;
+static uint8_t adcInput = 0;
+
+// Interrupts raised while disabled, run by sei()
+static void (*pending[4])();
+static uint8_t pendingCount = 0;
+
+static unsigned int timer1Prescaler() {
+	static const unsigned int PRESCALERS[] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+	return PRESCALERS[TCCR1B & 7];
+}
+
+static unsigned int timer2Prescaler() {
+	static const unsigned int PRESCALERS[] = { 0, 1, 8, 32, 64, 128, 256, 1024 };
+	return PRESCALERS[TCCR2B & 7];
+}
+
+static unsigned int adcConversionCycles() {
+	uint8_t adps = ADCSRA & 7;
+	return 13 * (adps == 0 ? 2 : 1 << adps);
+}
+
+static bool adcFreeRunning() {
+	uint8_t mask = _BV(ADEN) | _BV(ADATE) | _BV(ADSC);
+	return (ADCSRA & mask) == mask;
+}
+
+/**
+ * Cycles from the given start to the next compare match of a timer in CTC mode, that happens
+ * when the count reaches the compare value: the count then restarts from zero on the next tick
+ */
+static uint64_t compareMatchCycles(unsigned int count, unsigned int top, unsigned int bits, unsigned int prescaler) {
+	unsigned int ticks = count <= top ? top - count : (1U << bits) - count + top;
+	if (ticks == 0) ticks = top + 1;
+	return (uint64_t)ticks * prescaler;
+}
+
+/**
+ * Move the counts of the timers to the current time
+ */
+static void updateTimers() {
+	
+	unsigned int prescaler = timer1Prescaler();
+	if (prescaler > 0) {
+		uint64_t ticks = (now - timer1Start) / prescaler;
+		timer1Start += ticks * prescaler;
+		uint32_t period = (uint32_t)OCR1A + 1;
+		uint32_t count = TCNT1;
+		if (count <= OCR1A) {
+			count = (count + ticks) % period;
+		} else {
+			count = count + ticks < 65536 ? count + ticks : (count + ticks - 65536) % period;
+		}
+		TCNT1 = count;
+	} else {
+		timer1Start = now;
+	}
+	
+	prescaler = timer2Prescaler();
+	if (prescaler > 0) {
+		uint64_t ticks = (now - timer2Start) / prescaler;
+		timer2Start += ticks * prescaler;
+		uint32_t period = (uint32_t)OCR2A + 1;
+		uint32_t count = TCNT2;
+		if (count <= OCR2A) {
+			count = (count + ticks) % period;
+		} else {
+			count = count + ticks < 256 ? count + ticks : (count + ticks - 256) % period;
+		}
+		TCNT2 = count;
+	} else {
+		timer2Start = now;
+	}
+	
+	// Timer0 is left running by the Arduino core, with a count every 64 cycles
+	TCNT0 = (uint8_t)(now / 64);
+	
+	if (adcFreeRunning() && !adcRunning) {
+		adcRunning = true;
+		adcStart = now;
+		adcInput = ADMUX & 7;
+	} else if (!adcFreeRunning()) {
+		adcRunning = false;
+	}
+	
+}
+
+static void interrupt(void (*isr)()) {
+	if (!isr) return;
+	if (SREG & 0x80) {
+		cli(); // Interrupts don't nest
+		isr();
+		sei();
+	} else if (pendingCount < 4) {
+		pending[pendingCount++] = isr;
+	}
+}
+
+namespace Stub {
+	
+	uint8_t shifted[64];
+	unsigned int shiftedCount = 0;
+	uint32_t shiftedAfterTransmissions[64];
+	uint32_t digitalWrites = 0;
+	uint32_t digitalReads = 0;
+	
+	void reset(uint64_t us) {
+		now = us * CYCLES_PER_US;
+		watchdogStart = now;
+		timer1Start = now;
+		timer2Start = now;
+		adcRunning = false;
+		pendingCount = 0;
+		SREG = 0x80;
+		PORTB = PORTC = PORTD = 0;
+		PINB = PINC = PIND = 0;
+		DDRB = DDRC = DDRD = 0;
+		TCCR0A = TCCR0B = TIMSK0 = TIFR0 = TCNT0 = OCR0A = OCR0B = 0;
+		TCCR1A = TCCR1B = TIMSK1 = TIFR1 = 0;
+		TCNT1 = OCR1A = OCR1B = ICR1 = 0;
+		TCCR2A = TCCR2B = TIMSK2 = TIFR2 = TCNT2 = OCR2A = OCR2B = 0;
+		ADMUX = ADCSRA = ADCSRB = DIDR0 = 0;
+		ADC = 0;
+		PCICR = PCIFR = PCMSK0 = PCMSK1 = PCMSK2 = 0;
+		EIMSK = EICRA = 0;
+		WDTCSR = MCUSR = 0;
+		SPCR = SPSR = SPDR = 0;
+		memset(analogValues, 0, sizeof(analogValues));
+		interruptCallbacks[0] = interruptCallbacks[1] = 0;
+		shiftedCount = 0;
+		digitalWrites = 0;
+		digitalReads = 0;
+		SPI.transferredCount = 0;
+		Wire.transmissions = 0;
+		Wire.bytesWritten = 0;
+	}
+	
+	void advanceUs(uint32_t us) {
+		
+		uint64_t end = now + (uint64_t)us * CYCLES_PER_US;
+		while (true) {
+			
+			updateTimers();
+			
+			// Time of the next event of each source, if enabled
+			const uint64_t NEVER = UINT64_MAX;
+			uint64_t timer0 = NEVER, timer1 = NEVER, timer2 = NEVER, adc = NEVER;
+			if ((TIMSK0 & _BV(OCIE0B)) != 0) {
+				uint64_t tick = now / 64 + 1;
+				tick += (OCR0B - tick) & 0xFF; // Next tick where the count matches
+				timer0 = tick * 64;
+			}
+			if ((TIMSK1 & _BV(OCIE1A)) != 0 && timer1Prescaler() > 0) {
+				timer1 = timer1Start + compareMatchCycles(TCNT1, OCR1A, 16, timer1Prescaler());
+			}
+			if ((TIMSK2 & _BV(OCIE2A)) != 0 && timer2Prescaler() > 0) {
+				timer2 = timer2Start + compareMatchCycles(TCNT2, OCR2A, 8, timer2Prescaler());
+			}
+			if (adcRunning) {
+				adc = adcStart + adcConversionCycles();
+			}
+			uint64_t next = min(min(min(timer0, timer1), min(timer2, adc)), end);
+			
+			now = next;
+			updateTimers();
+			if (next == adc) {
+				ADC = analogValues[adcInput];
+				adcStart = now;
+				adcInput = ADMUX & 7; // The next conversion starts right away
+				if ((ADCSRA & _BV(ADIE)) != 0) interrupt(ADC_vect);
+			}
+			if (next == timer0) interrupt(TIMER0_COMPB_vect);
+			if (next == timer1) interrupt(TIMER1_COMPA_vect);
+			if (next == timer2) interrupt(TIMER2_COMPA_vect);
+			if (now >= end) break;
+			
+		}
+		
+	}
+	
+	uint64_t timeUs() {
+		return now / CYCLES_PER_US;
+	}
+	
+	void setAnalog(uint8_t pin, int value) {
+		analogValues[pin >= A0 ? pin - A0 : pin] = value;
+	}
+	
+	static volatile uint8_t& inputRegister(uint8_t pin) {
+		return pin < 8 ? PIND : (pin < 14 ? PINB : PINC);
+	}
+	
+	static volatile uint8_t& outputRegister(uint8_t pin) {
+		return pin < 8 ? PORTD : (pin < 14 ? PORTB : PORTC);
+	}
+	
+	void setInput(uint8_t pin, bool value) {
+		
+		bool previous = (inputRegister(pin) & digitalPinToBitMask(pin)) != 0;
+		if (value) {
+			inputRegister(pin) |= digitalPinToBitMask(pin);
+		} else {
+			inputRegister(pin) &= ~digitalPinToBitMask(pin);
+		}
+		
+		// External interrupts on pins 2 and 3
+		int i = digitalPinToInterrupt(pin);
+		if (i >= 0 && interruptCallbacks[i] && value != previous) {
+			int mode = interruptModes[i];
+			if (mode == CHANGE || (mode == RISING && value) || (mode == FALLING && !value)) {
+				interrupt(interruptCallbacks[i]);
+			}
+		}
+		
+	}
+	
+	bool getOutput(uint8_t pin) {
+		return (outputRegister(pin) & digitalPinToBitMask(pin)) != 0;
+	}
+	
+	void fireInterrupt(int interrupt) {
+		if (interruptCallbacks[interrupt]) ::interrupt(interruptCallbacks[interrupt]);
+	}
+	
+}
+
+uint32_t millis() {
+	return (uint32_t)(now / CYCLES_PER_US / 1000);
+}
+
+uint32_t micros() {
+	return (uint32_t)(now / CYCLES_PER_US);
+}
+
+void delay(uint32_t ms) {
+	Stub::advanceUs(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+	Stub::advanceUs(us);
+}
+
+void cli() {
+	SREG &= ~0x80;
+}
+
+void sei() {
+	SREG |= 0x80;
+	while (pendingCount > 0) {
+		void (*isr)() = pending[0];
+		pendingCount--;
+		memmove(pending, pending + 1, pendingCount * sizeof(pending[0]));
+		interrupt(isr);
+	}
+}
+
+uint8_t digitalPinToPort(uint8_t pin) {
+	if (pin > 19) return NOT_A_PORT;
+	return pin < 8 ? PD : (pin < 14 ? PB : PC);
+}
+
+uint8_t digitalPinToBitMask(uint8_t pin) {
+	return 1 << (pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14));
+}
+
+volatile uint8_t* portOutputRegister(uint8_t port) {
+	return port == PB ? &PORTB : (port == PC ? &PORTC : &PORTD);
+}
+
+volatile uint8_t* portInputRegister(uint8_t port) {
+	return port == PB ? &PINB : (port == PC ? &PINC : &PIND);
+}
+
+volatile uint8_t* portModeRegister(uint8_t port) {
+	return port == PB ? &DDRB : (port == PC ? &DDRC : &DDRD);
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+	uint8_t port = digitalPinToPort(pin);
+	uint8_t mask = digitalPinToBitMask(pin);
+	if (port == NOT_A_PORT) return;
+	if (mode == OUTPUT) {
+		*portModeRegister(port) |= mask;
+	} else {
+		*portModeRegister(port) &= ~mask;
+		if (mode == INPUT_PULLUP) {
+			*portOutputRegister(port) |= mask;
+		} else {
+			*portOutputRegister(port) &= ~mask;
+		}
+	}
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+	uint8_t port = digitalPinToPort(pin);
+	uint8_t mask = digitalPinToBitMask(pin);
+	Stub::digitalWrites++;
+	if (port == NOT_A_PORT) return;
+	if (value == LOW) {
+		*portOutputRegister(port) &= ~mask;
+	} else {
+		*portOutputRegister(port) |= mask;
+	}
+}
+
+int digitalRead(uint8_t pin) {
+	uint8_t port = digitalPinToPort(pin);
+	Stub::digitalReads++;
+	if (port == NOT_A_PORT) return LOW;
+	return (*portInputRegister(port) & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+int analogRead(uint8_t pin) {
+	
+	Stub::advanceUs(ANALOG_READ_US);
+	
+	// The watchdog flag is polled by FastRandom::entropy() with interrupts disabled
+	if ((WDTCSR & _BV(WDIE)) != 0 && now - watchdogStart >= (uint64_t)WATCHDOG_US * CYCLES_PER_US) {
+		WDTCSR |= _BV(WDIF);
+		watchdogStart = now;
+	}
+	
+	return analogValues[(pin >= A0 ? pin - A0 : pin) & 7];
+	
+}
+
+void analogWrite(uint8_t pin, int value) {
+	pinMode(pin, OUTPUT);
+	digitalWrite(pin, value >= 128 ? HIGH : LOW);
+}
+
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t value) {
+	
+	// Recorded in the order bits leave the pin, the first one as the most significant
+	uint8_t wire = value;
+	if (bitOrder == LSBFIRST) {
+		wire = 0;
+		for (uint8_t i = 0; i < 8; i++) {
+			if (value & (1 << i)) wire |= 0x80 >> i;
+		}
+	}
+	if (Stub::shiftedCount < sizeof(Stub::shifted)) {
+		Stub::shiftedAfterTransmissions[Stub::shiftedCount] = Wire.transmissions;
+		Stub::shifted[Stub::shiftedCount++] = wire;
+	}
+	
+	for (uint8_t i = 0; i < 8; i++) {
+		digitalWrite(dataPin, (wire >> (7 - i)) & 1);
+		digitalWrite(clockPin, HIGH);
+		digitalWrite(clockPin, LOW);
+	}
+	
+}
+
+void attachInterrupt(int interrupt, void (*callback)(), int mode) {
+	if (interrupt == 0 || interrupt == 1) {
+		interruptCallbacks[interrupt] = callback;
+		interruptModes[interrupt] = mode;
+	}
+}
+
+void detachInterrupt(int interrupt) {
+	if (interrupt == 0 || interrupt == 1) interruptCallbacks[interrupt] = 0;
+}
+
+int32_t random(int32_t max) {
+	return max > 0 ? rand() % max : 0;
+}
+
+int32_t random(int32_t min, int32_t max) {
+	return max > min ? min + random(max - min) : min;
+}
+
+void randomSeed(uint32_t seed) {
+	srand(seed);
+}
@@ -0,0 +1,178 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+// Minimal Arduino core for host tests: AVR registers are plain variables, pins are mapped on them as on the
+// ATmega328P (Nano), time only moves when a test advances it. Every system header used by the tests is
+// included here, before "long" is redefined at the end of this file.
+
+#include <stdint.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "avr/io.h"
+#include "avr/interrupt.h"
+#include "avr/pgmspace.h"
+#include "binary.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define bit(b) (1UL << (b))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+#define digitalPinToPCICR(p) (((p) >= 0 && (p) <= 21) ? (&PCICR) : ((uint8_t*)0))
+#define digitalPinToPCICRbit(p) (((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p) (((p) <= 7) ? (&PCMSK2) : (((p) <= 13) ? (&PCMSK0) : (&PCMSK1)))
+#define digitalPinToPCMSKbit(p) (((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+#define digitalPinToInterrupt(p) ((p) == 2 ? 0 : ((p) == 3 ? 1 : -1))
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+// Time, in microseconds since the start, moved by the tests and by delay()
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t value);
+
+uint8_t digitalPinToPort(uint8_t pin);
+uint8_t digitalPinToBitMask(uint8_t pin);
+volatile uint8_t* portOutputRegister(uint8_t port);
+volatile uint8_t* portInputRegister(uint8_t port);
+volatile uint8_t* portModeRegister(uint8_t port);
+
+void attachInterrupt(int interrupt, void (*callback)(), int mode);
+void detachInterrupt(int interrupt);
+
+int32_t random(int32_t max);
+int32_t random(int32_t min, int32_t max);
+void randomSeed(uint32_t seed);
+
+class String {
+	public:
+		String(const char* s = "") { this->set(s); }
+		String(int n) { snprintf(this->buffer, sizeof(this->buffer), "%d", n); }
+		String& concat(const char* s) { strncat(this->buffer, s, sizeof(this->buffer) - strlen(this->buffer) - 1); return *this; }
+		String& concat(const String& s) { return this->concat(s.buffer); }
+		String& concat(int32_t n) { char s[12]; snprintf(s, sizeof(s), "%d", (int)n); return this->concat(s); }
+		unsigned int length() const { return strlen(this->buffer); }
+		const char* c_str() const { return this->buffer; }
+	private:
+		char buffer[128];
+		void set(const char* s) { this->buffer[0] = 0; this->concat(s); }
+};
+
+// Serial output is discarded
+class HardwareSerial {
+	public:
+		void begin(uint32_t) {}
+		template <class T> size_t print(T) { return 0; }
+		template <class T> size_t print(T, int) { return 0; }
+		template <class T> size_t println(T) { return 0; }
+		template <class T> size_t println(T, int) { return 0; }
+		size_t println() { return 0; }
+		size_t write(uint8_t) { return 1; }
+		void flush() {}
+		int available() { return 0; }
+		int read() { return -1; }
+		operator bool() { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// Control of the simulated hardware from the tests
+namespace Stub {
+	
+	/** Restart the time from the given microseconds (the millis() count follows), clear registers and pins */
+	void reset(uint64_t us = 0);
+	
+	/** Move the time forward */
+	void advanceUs(uint32_t us);
+	
+	/** Return the time, never wrapping */
+	uint64_t timeUs();
+	
+	/** Set the value returned by analogRead() for a pin */
+	void setAnalog(uint8_t pin, int value);
+	
+	/** Set a digital input, as seen by digitalRead() and the PINx registers */
+	void setInput(uint8_t pin, bool value);
+	
+	/** Return the level of a digital output, as written to the PORTx registers */
+	bool getOutput(uint8_t pin);
+	
+	/** Call the function attached to an external interrupt, if any */
+	void fireInterrupt(int interrupt);
+	
+	/** Bytes shifted out by shiftOut(), in order, and their count */
+	extern uint8_t shifted[64];
+	extern unsigned int shiftedCount;
+	
+	/** I2C transmissions begun before each shifted byte, to check the order of the outputs */
+	extern uint32_t shiftedAfterTransmissions[64];
+	
+	/** Number of digitalWrite() and digitalRead() calls */
+	extern uint32_t digitalWrites;
+	extern uint32_t digitalReads;
+	
+}
+
+// Long is 32 bits on AVR: keep it that way, so that overflows and wrap-arounds happen as on the target
+#define long int
+
+#endif
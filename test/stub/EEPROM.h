@@ -0,0 +1,21 @@
+#ifndef EEPROM_h
+#define EEPROM_h
+
+// EEPROM in memory, erased (0xFF) at the start
+
+#include "Arduino.h"
+
+class EEPROMClass {
+	public:
+		EEPROMClass() { memset(this->data, 0xFF, sizeof(this->data)); }
+		uint8_t read(int address) { return this->data[address]; }
+		void write(int address, uint8_t value) { this->data[address] = value; }
+		void update(int address, uint8_t value) { this->data[address] = value; }
+		template <class T> T& get(int address, T& t) { memcpy(&t, this->data + address, sizeof(T)); return t; }
+		template <class T> const T& put(int address, const T& t) { memcpy(this->data + address, &t, sizeof(T)); return t; }
+		uint8_t data[1024];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef MIDI_h
+#define MIDI_h
+
+// MIDI library interface, receiving nothing
+
+#include "Arduino.h"
+
+#define MIDI_CHANNEL_OMNI 0
+
+namespace midi {
+	
+	struct DefaultSettings {
+		static const bool UseRunningStatus = false;
+		static const bool HandleNullVelocityNoteOnAsNoteOff = true;
+		static const bool Use1ByteParsing = true;
+		static const uint32_t BaudRate = 31250;
+		static const unsigned SysExMaxSize = 128;
+	};
+	
+	template <class SerialPort, class Settings>
+	class MidiInterface {
+		public:
+			void begin(int = 1) {}
+			void turnThruOff() {}
+			bool read() { return false; }
+			template <class Callback> void setHandleNoteOn(Callback) {}
+			template <class Callback> void setHandleNoteOff(Callback) {}
+			template <class Callback> void setHandlePitchBend(Callback) {}
+			template <class Callback> void setHandleClock(Callback) {}
+			template <class Callback> void setHandleStart(Callback) {}
+			template <class Callback> void setHandleContinue(Callback) {}
+			template <class Callback> void setHandleStop(Callback) {}
+			template <class Callback> void setHandleSongPosition(Callback) {}
+	};
+	
+}
+
+#define MIDI_CREATE_CUSTOM_INSTANCE(Type, SerialPort, Name, Settings) midi::MidiInterface<Type, Settings> Name;
+
+#endif
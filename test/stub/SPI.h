@@ -0,0 +1,41 @@
+#ifndef SPI_h
+#define SPI_h
+
+// Hardware SPI, recording the transferred bytes
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0x00
+
+class SPISettings {
+	public:
+		SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode) : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+		uint32_t clock;
+		uint8_t bitOrder;
+		uint8_t dataMode;
+};
+
+class SPIClass {
+	public:
+		void begin() {}
+		void beginTransaction(SPISettings settings) { this->bitOrder = settings.bitOrder; }
+		uint8_t transfer(uint8_t data) {
+			uint8_t wire = data; // Recorded in the order bits leave the pin, the first one as the most significant
+			if (this->bitOrder == LSBFIRST) {
+				wire = 0;
+				for (uint8_t i = 0; i < 8; i++) {
+					if (data & (1 << i)) wire |= 0x80 >> i;
+				}
+			}
+			if (this->transferredCount < sizeof(this->transferred)) this->transferred[this->transferredCount++] = wire;
+			return 0;
+		}
+		void endTransaction() {}
+		uint8_t bitOrder = MSBFIRST;
+		uint8_t transferred[64];
+		unsigned int transferredCount = 0;
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef avr_interrupt_h
+#define avr_interrupt_h
+
+// Interrupt handlers are plain functions, called by the tests to simulate the interrupts
+
+#define ISR(vector, ...) extern "C" void vector(void)
+#define ISR_NOBLOCK
+
+void cli();
+void sei();
+
+#endif
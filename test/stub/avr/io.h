@@ -0,0 +1,104 @@
+#ifndef avr_io_h
+#define avr_io_h
+
+// ATmega328P registers used by the libraries and modules, as plain variables defined in Arduino.cpp
+
+#include <stdint.h>
+
+#define F_CPU 16000000UL
+
+#define _BV(b) (1 << (b))
+#define bit_is_set(r, b) ((r) & _BV(b))
+#define bit_is_clear(r, b) (!((r) & _BV(b)))
+
+extern volatile uint8_t SREG;
+
+extern volatile uint8_t PORTB, PORTC, PORTD;
+extern volatile uint8_t PINB, PINC, PIND;
+extern volatile uint8_t DDRB, DDRC, DDRD;
+
+extern volatile uint8_t TCCR0A, TCCR0B, TIMSK0, TIFR0, TCNT0, OCR0A, OCR0B;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1, OCR1A, OCR1B, ICR1;
+extern volatile uint8_t TCCR2A, TCCR2B, TIMSK2, TIFR2, TCNT2, OCR2A, OCR2B;
+
+extern volatile uint8_t ADMUX, ADCSRA, ADCSRB, DIDR0;
+extern volatile uint16_t ADC;
+
+extern volatile uint8_t PCICR, PCIFR, PCMSK0, PCMSK1, PCMSK2;
+extern volatile uint8_t EIMSK, EICRA;
+extern volatile uint8_t WDTCSR, MCUSR;
+extern volatile uint8_t SPCR, SPSR, SPDR;
+
+// Timer0
+#define OCIE0A 1
+#define OCIE0B 2
+#define OCF0A 1
+#define OCF0B 2
+
+// Timer1
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define OCIE1A 1
+#define OCIE1B 2
+#define OCF1A 1
+#define OCF1B 2
+
+// Timer2
+#define WGM20 0
+#define WGM21 1
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define OCIE2A 1
+#define OCF2A 1
+
+// ADC
+#define MUX0 0
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define ADTS0 0
+
+// Pin change interrupts
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+
+// Watchdog
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE 3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+#define WDIF 7
+#define WDRF 3
+
+// SPI
+#define SPR0 0
+#define SPR1 1
+#define MSTR 4
+#define SPE 6
+#define SPI2X 0
+#define SPIF 7
+
+// Pins of the hardware SPI, as in the Arduino pins_arduino.h
+#define SS 10
+#define MOSI 11
+#define MISO 12
+#define SCK 13
+
+#endif
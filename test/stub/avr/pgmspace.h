@@ -0,0 +1,18 @@
+#ifndef avr_pgmspace_h
+#define avr_pgmspace_h
+
+// Program memory is plain memory on the host. Tables of pointers are read with pgm_read_word() on AVR,
+// where pointers are 16 bits: here the element is returned whatever its type, so pointers stay whole.
+
+#include <stdint.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+template <class T> inline T pgmReadElement(const T* address) { return *address; }
+
+#define pgm_read_word(address) pgmReadElement(address)
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+#define pgm_read_ptr(address) (*(void* const*)(address))
+
+#endif
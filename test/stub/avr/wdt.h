@@ -0,0 +1,6 @@
+#ifndef avr_wdt_h
+#define avr_wdt_h
+
+inline void wdt_reset() {}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef test_h
+#define test_h
+
+// Minimal test framework for the host tests: each test is a program calling CHECK() and friends,
+// then returning testResult(), which is non-zero if anything failed.
+
+#include "Arduino.h"
+
+static int testFailures = 0;
+static int testChecks = 0;
+
+#define CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+#define CHECK_EQUAL(expected, actual) testCheckEqual((int64_t)(expected), (int64_t)(actual), #actual, __FILE__, __LINE__)
+#define CHECK_NEAR(expected, actual, tolerance) testCheckNear((double)(expected), (double)(actual), (double)(tolerance), #actual, __FILE__, __LINE__)
+
+static bool testCheck(bool passed, const char* expression, const char* file, int line) {
+	testChecks++;
+	if (!passed) {
+		testFailures++;
+		printf("%s:%d: FAILED %s\n", file, line, expression);
+	}
+	return passed;
+}
+
+static bool testCheckEqual(int64_t expected, int64_t actual, const char* expression, const char* file, int line) {
+	testChecks++;
+	if (expected != actual) {
+		testFailures++;
+		printf("%s:%d: FAILED %s is %" PRId64 ", expected %" PRId64 "\n", file, line, expression, actual, expected);
+		return false;
+	}
+	return true;
+}
+
+static bool testCheckNear(double expected, double actual, double tolerance, const char* expression, const char* file, int line) {
+	testChecks++;
+	if (fabs(expected - actual) > tolerance) {
+		testFailures++;
+		printf("%s:%d: FAILED %s is %g, expected %g within %g\n", file, line, expression, actual, expected, tolerance);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Print the summary, returning the exit status of the test program
+ */
+static int testResult() {
+	printf("%d checks, %d failed\n", testChecks, testFailures);
+	return testFailures > 0 ? 1 : 0;
+}
+
+#endif
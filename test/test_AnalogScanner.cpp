@@ -0,0 +1,99 @@
+// AnalogScanner on the simulated free-running ADC: channels are scanned in the order they were added, the conversion
+// started before switching input is discarded, and readings are filtered without bias.
+
+#include "test.h"
+#include "lib/AnalogScanner.cpp"
+
+const byte PINS[] { A0, A3, A1 };
+const int VALUES[] { 100, 900, 500 };
+
+byte channels[3];
+
+/**
+ * Move the time forward in small steps, recording the order of the inputs selected by the scanner
+ */
+unsigned int scan(uint32_t us, byte* order, unsigned int size) {
+	unsigned int count = 0;
+	byte last = 255;
+	for (uint32_t t = 0; t < us; t += 4) {
+		byte input = ADMUX & 0x0F;
+		if (input != last && count < size) order[count++] = input;
+		last = input;
+		Stub::advanceUs(4);
+	}
+	return count;
+}
+
+void testOrder() {
+	
+	// Inputs in the order they were added, over and over
+	byte order[30];
+	unsigned int count = scan(30000, order, 30);
+	CHECK_EQUAL(30, count);
+	unsigned int wrong = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		if (order[i] != PINS[i % 3] - A0) wrong++;
+	}
+	CHECK_EQUAL(0, wrong);
+	
+}
+
+void testReadings() {
+	
+	// Each channel reads its own input exactly, nothing from the previous one: the conversion started before the
+	// input was switched, which belongs to the previous input, is skipped
+	scan(50000, 0, 0);
+	for (byte i = 0; i < 3; i++) CHECK_EQUAL(VALUES[i], AnalogScanner::get(channels[i]));
+	
+}
+
+void testFilter() {
+	
+	// A step is smoothed over a few scans, then read exactly, rising or falling
+	const int STEPS[] { 700, 101, 1023, 0 };
+	for (byte s = 0; s < 4; s++) {
+		int from = AnalogScanner::get(channels[0]);
+		Stub::setAnalog(PINS[0], STEPS[s]);
+		scan(3000, 0, 0); // About two scans of the three inputs
+		int partial = AnalogScanner::get(channels[0]);
+		CHECK(partial != from && partial != STEPS[s]);
+		scan(50000, 0, 0);
+		CHECK_EQUAL(STEPS[s], AnalogScanner::get(channels[0]));
+	}
+	
+	// Noise on the least significant bits is averaged
+	unsigned int low = 1023;
+	unsigned int high = 0;
+	for (unsigned int t = 0; t < 20000; t++) {
+		Stub::setAnalog(PINS[1], 510 + (t * 7919) % 5); // 510 to 514
+		Stub::advanceUs(10);
+		if (t > 5000) {
+			low = min(low, (unsigned int)AnalogScanner::get(channels[1]));
+			high = max(high, (unsigned int)AnalogScanner::get(channels[1]));
+		}
+	}
+	CHECK(low >= 511 && high <= 513);
+	printf("Input noise from 510 to 514: readings from %u to %u\n", low, high);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	for (byte i = 0; i < 3; i++) {
+		Stub::setAnalog(PINS[i], VALUES[i]);
+		channels[i] = AnalogScanner::add(PINS[i]);
+		CHECK_EQUAL(i, channels[i]);
+	}
+	CHECK_EQUAL(channels[1], AnalogScanner::add(PINS[1])); // Same pin, same channel
+	AnalogScanner::start();
+	CHECK(AnalogScanner::isRunning());
+	for (byte i = 0; i < 3; i++) CHECK_EQUAL(VALUES[i], AnalogScanner::get(channels[i])); // Read once by start()
+	
+	testOrder();
+	testReadings();
+	testFilter();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,224 @@
+// ButtonBank against Button: the same scripted presses, with bounces, on pins read by both, give the same readings
+// in the same order, later by the debounce delay at most, while idle buttons cost no pin reads to the bank.
+// The cost of reading seven buttons in a main loop is then measured on the computer, as tools/button_benchmark does.
+
+#include <chrono>
+
+#include "test.h"
+#include "lib/Button.cpp"
+#include "lib/ButtonBank.cpp"
+
+const unsigned int DEBOUNCE_DELAY = 50;
+const unsigned long LONG_PRESS_MS = 500;
+const uint32_t LATENCY_MS = DEBOUNCE_DELAY + 15; // Four samples, each up to 12 ticks of 1.024 ms, plus the first one
+
+const byte SHORT_OR_LONG_PIN = 4; // Read with readShortOrLongPressOnce()
+const byte ONCE_PIN = 5; // Read with readOnce() and readLongPressOnce()
+const byte STATE_PIN = 6; // Read with read()
+const byte OTHER_PINS[] { 7, 8, 9, A0 }; // Up to seven buttons, as in In C, for the benchmark
+
+// Readings, as the reading value and the time in ms
+struct Reading {
+	byte value;
+	uint32_t ms;
+};
+
+struct Readings {
+	Reading readings[1000];
+	unsigned int count = 0;
+	void add(byte value) {
+		if (value != 0 && this->count < 1000) this->readings[this->count++] = { value, millis() };
+	}
+};
+
+Button button[7];
+byte bank[7];
+Readings buttonReadings[3];
+Readings bankReadings[3];
+uint32_t stateDifferentMs = 0; // Time read() differs between the two
+uint32_t stateMaxDifferentMs = 0; // Longest time in a row
+uint32_t stateDifferentInRow = 0;
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number below the given maximum
+ */
+uint32_t randomNumber(uint32_t max) {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % max;
+}
+
+/**
+ * Set all the pins, pressed when LOW
+ */
+void setPins(bool pressed) {
+	Stub::setInput(SHORT_OR_LONG_PIN, !pressed);
+	Stub::setInput(ONCE_PIN, !pressed);
+	Stub::setInput(STATE_PIN, !pressed);
+}
+
+/**
+ * Run the main loop for the given time, a pass every millisecond, reading the buttons of both kinds
+ */
+void run(uint32_t ms) {
+	for (uint32_t i = 0; i < ms; i++) {
+		buttonReadings[0].add(button[0].readShortOrLongPressOnce(LONG_PRESS_MS));
+		bankReadings[0].add(ButtonBank::readShortOrLongPressOnce(bank[0], LONG_PRESS_MS));
+		buttonReadings[1].add(button[1].readOnce() ? 1 : 0);
+		buttonReadings[1].add(button[1].readLongPressOnce(LONG_PRESS_MS) ? 2 : 0);
+		bankReadings[1].add(ButtonBank::readOnce(bank[1]) ? 1 : 0);
+		bankReadings[1].add(ButtonBank::readLongPressOnce(bank[1], LONG_PRESS_MS) ? 2 : 0);
+		if (button[2].read() != ButtonBank::read(bank[2])) {
+			stateDifferentMs++;
+			stateDifferentInRow++;
+			stateMaxDifferentMs = max(stateMaxDifferentMs, stateDifferentInRow);
+		} else {
+			stateDifferentInRow = 0;
+		}
+		Stub::advanceUs(1000);
+	}
+}
+
+/**
+ * Press the buttons for the given time, with a few bounces of a millisecond or less on both edges
+ */
+void press(uint32_t ms) {
+	for (byte edge = 0; edge < 2; edge++) {
+		bool pressed = edge == 0;
+		byte bounces = randomNumber(4);
+		for (byte b = 0; b < bounces; b++) {
+			setPins(pressed);
+			Stub::advanceUs(100 + randomNumber(900));
+			setPins(!pressed);
+			Stub::advanceUs(100 + randomNumber(900));
+		}
+		setPins(pressed);
+		run(edge == 0 ? ms : 0);
+	}
+}
+
+void testSemantics() {
+	
+	// Short presses up to 350 ms and long presses from 650 ms, far enough from the long press duration
+	// that the debounce delay can't make them cross it, with gaps of 150 ms at least
+	unsigned int shortPresses = 0;
+	unsigned int longPresses = 0;
+	for (unsigned int p = 0; p < 300; p++) {
+		bool isLong = randomNumber(3) == 0;
+		press(isLong ? 650 + randomNumber(1000) : 60 + randomNumber(290));
+		run(150 + randomNumber(1000));
+		if (isLong) {
+			longPresses++;
+		} else {
+			shortPresses++;
+		}
+	}
+	
+	// Same readings in the same order, the bank later by the latency at most
+	for (byte b = 0; b < 2; b++) {
+		CHECK_EQUAL(buttonReadings[b].count, bankReadings[b].count);
+		unsigned int different = 0;
+		uint32_t maxDelay = 0;
+		for (unsigned int r = 0; r < min(buttonReadings[b].count, bankReadings[b].count); r++) {
+			Reading& expected = buttonReadings[b].readings[r];
+			Reading& actual = bankReadings[b].readings[r];
+			if (expected.value != actual.value) different++;
+			uint32_t delay = actual.ms > expected.ms ? actual.ms - expected.ms : expected.ms - actual.ms;
+			maxDelay = max(maxDelay, delay);
+		}
+		CHECK_EQUAL(0, different);
+		CHECK(maxDelay <= LATENCY_MS);
+		printf("%u short and %u long presses, button %u: %u readings, at most %u ms apart\n",
+			shortPresses, longPresses, b, bankReadings[b].count, maxDelay);
+	}
+	CHECK_EQUAL(shortPresses + longPresses, bankReadings[0].count);
+	
+	// The pressed state differs only around the edges
+	CHECK(stateMaxDifferentMs <= LATENCY_MS);
+	printf("Pressed state different for %u ms out of %u, at most %u ms in a row\n",
+		stateDifferentMs, millis(), stateMaxDifferentMs);
+	
+}
+
+void testIdle() {
+	
+	// Button reads the pin on every call, the bank never does
+	uint32_t reads = Stub::digitalReads;
+	for (byte i = 0; i < 100; i++) button[0].readShortOrLongPressOnce(LONG_PRESS_MS);
+	CHECK_EQUAL(reads + 100, Stub::digitalReads);
+	reads = Stub::digitalReads;
+	for (byte i = 0; i < 100; i++) ButtonBank::readShortOrLongPressOnce(bank[0], LONG_PRESS_MS);
+	CHECK_EQUAL(reads, Stub::digitalReads);
+	
+}
+
+/**
+ * Time of a main loop reading all the buttons with the given function, in ns on the computer
+ */
+template <class F>
+double benchmark(F readAll) {
+	const unsigned int LOOPS = 1000000;
+	volatile byte sink = 0; // Keeps the readings from being optimized away
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int l = 0; l < LOOPS; l++) sink = sink + readAll();
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / LOOPS;
+}
+
+void testBenchmark() {
+	
+	// Idle buttons, read with readShortOrLongPressOnce() one by one, or at once as a bitmask
+	double buttonNs = benchmark([]() {
+		byte r = 0;
+		for (byte i = 0; i < 7; i++) r |= button[i].readShortOrLongPressOnce(LONG_PRESS_MS);
+		return r;
+	});
+	double bankNs = benchmark([]() {
+		byte r = 0;
+		for (byte i = 0; i < 7; i++) r |= ButtonBank::readShortOrLongPressOnce(bank[i], LONG_PRESS_MS);
+		return r;
+	});
+	double bitmaskNs = benchmark([]() {
+		return ButtonBank::readPresses();
+	});
+	
+	// The sampling tick, once every debounce delay / 4 (12 ms), debouncing all the pins of the used ports
+	const unsigned int TICKS = 1000000;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int t = 0; t < TICKS; t++) ButtonBank::isr();
+	auto end = std::chrono::steady_clock::now();
+	double tickNs = std::chrono::duration<double, std::nano>(end - start).count() / TICKS;
+	
+	printf("Seven idle buttons on the computer: Button %.1f ns/loop, ButtonBank %.1f ns/loop, bitmask %.1f ns/loop, "
+		"timer tick %.1f ns\n", buttonNs, bankNs, bitmaskNs, tickNs);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	
+	// Pulled up, not pressed
+	const byte PINS[] { SHORT_OR_LONG_PIN, ONCE_PIN, STATE_PIN };
+	setPins(false);
+	for (byte b = 0; b < 3; b++) {
+		button[b].init(PINS[b], DEBOUNCE_DELAY, true, true);
+		bank[b] = ButtonBank::add(PINS[b], true, true);
+		CHECK_EQUAL(b, bank[b]);
+	}
+	for (byte b = 3; b < 7; b++) {
+		Stub::setInput(OTHER_PINS[b - 3], HIGH);
+		button[b].init(OTHER_PINS[b - 3], DEBOUNCE_DELAY, true, true);
+		bank[b] = ButtonBank::add(OTHER_PINS[b - 3], true, true);
+	}
+	ButtonBank::start(DEBOUNCE_DELAY);
+	run(100);
+	
+	testSemantics();
+	testIdle();
+	testBenchmark();
+	
+	return testResult();
+	
+}
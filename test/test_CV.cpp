@@ -0,0 +1,97 @@
+// CV readings: the fixed-point readQ15() against the float read(), exhaustively over every analogRead() value,
+// and the change events of noisy inputs with hysteresis
+
+#include "test.h"
+#include "lib/CV.cpp"
+
+const byte PIN = A0;
+
+void testReadQ15() {
+	
+	// Full range, narrow ranges, ranges of one step, inverted or not
+	const int THRESHOLDS[][2] { { 0, 1023 }, { 10, 1000 }, { 100, 900 }, { 300, 700 }, { 0, 1 }, { 512, 513 }, { 1022, 1023 } };
+	unsigned int worst = 0;
+	for (byte t = 0; t < sizeof(THRESHOLDS) / sizeof(THRESHOLDS[0]); t++) {
+		for (byte invert = 0; invert < 2; invert++) {
+			CV cv;
+			cv.init(PIN, THRESHOLDS[t][0], THRESHOLDS[t][1], invert);
+			for (int r = 0; r < 1024; r++) {
+				Stub::setAnalog(PIN, r);
+				unsigned int q = cv.readQ15();
+				long expected = (long)(cv.read() * 32768.0 + 0.5);
+				unsigned int error = abs((long)q - expected);
+				if (error > worst) worst = error;
+				if (error > 1) {
+					printf("Thresholds %d-%d%s, reading %d: %u instead of %d\n", THRESHOLDS[t][0], THRESHOLDS[t][1],
+						invert ? " inverted" : "", r, q, (int)expected);
+				}
+				CHECK(q <= Q15_ONE);
+			}
+		}
+	}
+	CHECK(worst <= 1);
+	printf("readQ15() against read(), every reading, 14 mappings: largest difference %u / 32768\n", worst);
+	
+}
+
+uint32_t randomState = 1;
+
+/**
+ * Count the changes reported over a number of readings of a noisy input, around a value and up to an amplitude
+ */
+unsigned int countChanges(CV& cv, int value, int noise, unsigned int readings) {
+	unsigned int changes = 0;
+	for (unsigned int i = 0; i < readings; i++) {
+		randomState = randomState * 1103515245 + 12345;
+		Stub::setAnalog(PIN, value + (int)((randomState >> 8) % (2 * noise + 1)) - noise);
+		if (cv.changed()) changes++;
+		cv.readQ15();
+	}
+	return changes;
+}
+
+void testHysteresis() {
+	
+	// Noise of one and two LSB on a still knob, without and with hysteresis
+	const int NOISE[] { 1, 2 };
+	for (byte i = 0; i < 2; i++) {
+		CV cv;
+		cv.init(PIN);
+		unsigned int without = countChanges(cv, 512, NOISE[i], 10000);
+		cv.setHysteresis(NOISE[i] * 2);
+		unsigned int with = countChanges(cv, 512, NOISE[i], 10000);
+		CHECK(without > 5000);
+		CHECK_EQUAL(0, with);
+		printf("Noise of +/-%d on 10000 readings: %u changes without hysteresis, %u with hysteresis %d\n",
+			NOISE[i], without, with, NOISE[i] * 2);
+	}
+	
+	// A knob turned slowly is still followed, and reaches both ends exactly
+	CV cv;
+	cv.init(PIN);
+	cv.setHysteresis(2);
+	unsigned int changes = 0;
+	for (int r = 0; r <= 1023; r++) {
+		Stub::setAnalog(PIN, r);
+		if (cv.changed()) changes++;
+	}
+	CHECK_EQUAL(Q15_ONE, cv.readQ15());
+	CHECK(changes >= 1023 / 3);
+	for (int r = 1023; r >= 0; r--) {
+		Stub::setAnalog(PIN, r);
+		cv.changed();
+	}
+	CHECK_EQUAL(0, cv.readQ15());
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	
+	testReadQ15();
+	testHysteresis();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,101 @@
+// FastPin against the ATmega328P pinout of the Arduino Uno and Nano (datasheet and the core's pins_arduino.h): the
+// port and bit resolved at compile time for each pin, and the registers written and read by each operation.
+
+#include "test.h"
+#include "lib/FastPin.cpp"
+
+// Port letter and bit of Arduino pins D0-D13 and A0-A5
+const struct {
+	char port;
+	byte bit;
+} PINOUT[20] {
+	{ 'D', 0 }, { 'D', 1 }, { 'D', 2 }, { 'D', 3 }, { 'D', 4 }, { 'D', 5 }, { 'D', 6 }, { 'D', 7 }, // D0-D7
+	{ 'B', 0 }, { 'B', 1 }, { 'B', 2 }, { 'B', 3 }, { 'B', 4 }, { 'B', 5 }, // D8-D13
+	{ 'C', 0 }, { 'C', 1 }, { 'C', 2 }, { 'C', 3 }, { 'C', 4 }, { 'C', 5 }, // A0-A5
+};
+
+// Resolved by the compiler
+static_assert(FastPin<2>::PORT == 2 && FastPin<2>::MASK == 0x04, "Pin 2 is PD2");
+static_assert(FastPin<13>::PORT == 0 && FastPin<13>::MASK == 0x20, "Pin 13 is PB5");
+static_assert(FastPin<A5>::PORT == 1 && FastPin<A5>::MASK == 0x20, "Pin A5 is PC5");
+
+/**
+ * Registers of a port: 0 for port B, 1 for port C and 2 for port D
+ */
+volatile uint8_t& portRegister(byte port) {
+	return port == 0 ? PORTB : (port == 1 ? PORTC : PORTD);
+}
+
+volatile uint8_t& ddrRegister(byte port) {
+	return port == 0 ? DDRB : (port == 1 ? DDRC : DDRD);
+}
+
+volatile uint8_t& pinRegister(byte port) {
+	return port == 0 ? PINB : (port == 1 ? PINC : PIND);
+}
+
+/**
+ * Check the operations of a pin and of the following ones, returning the wrong results
+ */
+template <byte PIN>
+struct CheckPins {
+	static unsigned int run() {
+		
+		unsigned int wrong = 0;
+		byte port = PINOUT[PIN].port == 'B' ? 0 : (PINOUT[PIN].port == 'C' ? 1 : 2);
+		byte mask = 1 << PINOUT[PIN].bit;
+		if (FastPin<PIN>::PORT != port || FastPin<PIN>::MASK != mask) wrong++;
+		if (fastPinPort(PIN) != port || fastPinMask(PIN) != mask) wrong++;
+		
+		// Other bits and ports are left alone
+		for (byte p = 0; p < 3; p++) {
+			portRegister(p) = 0x5A;
+			ddrRegister(p) = 0x5A;
+			pinRegister(p) = 0x00;
+		}
+		FastPin<PIN>::output();
+		if (ddrRegister(port) != (0x5A | mask)) wrong++;
+		FastPin<PIN>::high();
+		if (portRegister(port) != (0x5A | mask)) wrong++;
+		FastPin<PIN>::low();
+		if (portRegister(port) != (0x5A & ~mask)) wrong++;
+		FastPin<PIN>::write(true);
+		if (portRegister(port) != (0x5A | mask)) wrong++;
+		FastPin<PIN>::input(false);
+		if (ddrRegister(port) != (0x5A & ~mask) || portRegister(port) != (0x5A & ~mask)) wrong++;
+		FastPin<PIN>::input(true);
+		if (portRegister(port) != (0x5A | mask)) wrong++;
+		FastPin<PIN>::toggle(); // Writing a one to the input register toggles the output
+		if (pinRegister(port) != mask) wrong++;
+		pinRegister(port) = ~mask;
+		if (FastPin<PIN>::read()) wrong++;
+		pinRegister(port) = mask;
+		if (!FastPin<PIN>::read()) wrong++;
+		for (byte p = 0; p < 3; p++) {
+			if (p == port) continue;
+			if (portRegister(p) != 0x5A || ddrRegister(p) != 0x5A) wrong++;
+		}
+		
+		// Same as the Arduino core
+		if (digitalPinToPort(PIN) - PB != port || digitalPinToBitMask(PIN) != mask) wrong++;
+		
+		return wrong + CheckPins<PIN + 1>::run();
+		
+	}
+};
+
+template <>
+struct CheckPins<20> {
+	static unsigned int run() {
+		return 0;
+	}
+};
+
+int main() {
+	
+	Stub::reset();
+	CHECK_EQUAL(0, CheckPins<0>::run());
+	
+	return testResult();
+	
+}
@@ -0,0 +1,87 @@
+// Statistical tests of FastRandom: frequency and runs tests of chance() over millions of decisions at several
+// probabilities, and a chi-square test of the bytes of next()
+
+#include <math.h>
+
+#include "test.h"
+#include "lib/FastRandom.cpp"
+
+const unsigned long DECISIONS = 2000000;
+
+void testChance() {
+	
+	// For each probability, the number of TRUE outcomes and the number of runs of equal outcomes must be within
+	// 4 standard deviations of their expected values for independent decisions (Wald-Wolfowitz runs test)
+	const unsigned long PROBABILITIES[] { 655, 6554, 16384, 32768, 58982, 65535 }; // 1%, 10%, 25%, 50%, 90%, ~100%
+	const unsigned long SEEDS[] { 1, 0x12345678UL, 0 };
+	for (byte s = 0; s < sizeof(SEEDS) / sizeof(SEEDS[0]); s++) {
+		for (byte i = 0; i < sizeof(PROBABILITIES) / sizeof(PROBABILITIES[0]); i++) {
+			FastRandom random;
+			random.init(SEEDS[s]);
+			double p = PROBABILITIES[i] / 65536.0;
+			unsigned long ones = 0;
+			unsigned long runs = 0;
+			bool last = false;
+			for (unsigned long d = 0; d < DECISIONS; d++) {
+				bool outcome = random.chance(PROBABILITIES[i]);
+				if (outcome) ones++;
+				if (d == 0 || outcome != last) runs++;
+				last = outcome;
+			}
+			double frequency = (ones - DECISIONS * p) / sqrt(DECISIONS * p * (1 - p));
+			double q = (double)ones / DECISIONS;
+			double expectedRuns = 2 * DECISIONS * q * (1 - q) + 1;
+			double runsDeviation = 2 * sqrt(DECISIONS) * q * (1 - q);
+			double runsScore = runsDeviation > 0 ? (runs - expectedRuns) / runsDeviation : 0;
+			CHECK(fabs(frequency) < 4);
+			CHECK(fabs(runsScore) < 4);
+			if (s == 0) {
+				printf("chance() at %.4f over %u decisions: frequency z = %.2f, runs z = %.2f\n", p,
+					(unsigned int)DECISIONS, frequency, runsScore);
+			}
+		}
+	}
+	
+	// Never and always
+	FastRandom random;
+	random.init(1);
+	bool never = false;
+	bool always = true;
+	for (unsigned long d = 0; d < 100000; d++) {
+		never = never || random.chance(0);
+		always = always && random.chance(65536);
+	}
+	CHECK(!never);
+	CHECK(always);
+	
+}
+
+void testBytes() {
+	
+	// Each byte of next() is uniform: chi-square with 255 degrees of freedom, mean 255 and standard deviation 22.6
+	FastRandom random;
+	random.init(1);
+	unsigned long counts[4][256];
+	memset(counts, 0, sizeof(counts));
+	for (unsigned long d = 0; d < DECISIONS; d++) {
+		unsigned long x = random.next();
+		for (byte b = 0; b < 4; b++) counts[b][(x >> (8 * b)) & 0xFF]++;
+	}
+	for (byte b = 0; b < 4; b++) {
+		double expected = DECISIONS / 256.0;
+		double chiSquare = 0;
+		for (int v = 0; v < 256; v++) chiSquare += (counts[b][v] - expected) * (counts[b][v] - expected) / expected;
+		CHECK(chiSquare < 255 + 5 * 22.6);
+		printf("next() byte %u over %u numbers: chi-square %.1f\n", b, (unsigned int)DECISIONS, chiSquare);
+	}
+	
+}
+
+int main() {
+	
+	testChance();
+	testBytes();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,109 @@
+// Gesture on scripted press timelines: taps, holds and holds after taps are reported once, at the expected time, with
+// the right number of taps, anywhere in time, across the wrap-around of the 16 bits kept and of millis().
+
+#include "test.h"
+#include "lib/Gesture.cpp"
+
+const unsigned int TAP_MS = 400;
+const unsigned int HOLD_MS = 500;
+
+// A press, from and to the given times in ms from the start of the timeline
+struct Press {
+	uint32_t from;
+	uint32_t to;
+};
+
+// A gesture, reported at the given time
+struct Expected {
+	byte gesture;
+	byte taps;
+	uint32_t ms;
+};
+
+struct Timeline {
+	const char* name;
+	Press presses[4];
+	byte pressesCount;
+	Expected expected[3];
+	byte expectedCount;
+};
+
+const Timeline TIMELINES[] {
+	{ "Single tap", { { 0, 100 } }, 1, { { Gesture::TAP, 1, 100 + TAP_MS + 1 } }, 1 },
+	{ "Double tap", { { 0, 100 }, { 300, 400 } }, 2, { { Gesture::TAP, 2, 400 + TAP_MS + 1 } }, 1 },
+	{ "Triple tap", { { 0, 80 }, { 200, 280 }, { 600, 700 } }, 3, { { Gesture::TAP, 3, 700 + TAP_MS + 1 } }, 1 },
+	{ "Taps too far apart", { { 0, 100 }, { 100 + TAP_MS + 50, 600 } }, 2,
+		{ { Gesture::TAP, 1, 100 + TAP_MS + 1 }, { Gesture::TAP, 1, 600 + TAP_MS + 1 } }, 2 },
+	{ "Hold", { { 0, 2000 } }, 1, { { Gesture::HOLD, 0, HOLD_MS } }, 1 },
+	{ "Tap and hold", { { 0, 100 }, { 300, 1500 } }, 2, { { Gesture::TAP_HOLD, 1, 300 + HOLD_MS } }, 1 },
+	{ "Two taps and hold", { { 0, 100 }, { 300, 400 }, { 700, 1300 } }, 3, { { Gesture::TAP_HOLD, 2, 700 + HOLD_MS } }, 1 },
+	{ "Hold then tap", { { 0, 700 }, { 800, 900 } }, 2,
+		{ { Gesture::HOLD, 0, HOLD_MS }, { Gesture::TAP, 1, 900 + TAP_MS + 1 } }, 2 },
+	{ "Released just before the hold", { { 0, HOLD_MS - 1 } }, 1, { { Gesture::TAP, 1, HOLD_MS - 1 + TAP_MS + 1 } }, 1 },
+};
+
+/**
+ * Play a timeline from the given time, polling every millisecond, and return the wrong gestures
+ */
+unsigned int play(const Timeline& timeline, uint32_t startMs) {
+	Gesture gesture;
+	gesture.init();
+	unsigned int wrong = 0;
+	byte reported = 0;
+	for (uint32_t t = 0; t < 5000; t++) {
+		uint32_t ms = startMs + t;
+		for (byte p = 0; p < timeline.pressesCount; p++) {
+			if (t == timeline.presses[p].from) gesture.press(ms, TAP_MS);
+			if (t == timeline.presses[p].to) gesture.release(ms);
+		}
+		byte g = gesture.poll(ms, TAP_MS, HOLD_MS);
+		if (g == Gesture::NONE) continue;
+		if (reported >= timeline.expectedCount) {
+			wrong++;
+		} else {
+			const Expected& expected = timeline.expected[reported];
+			if (g != expected.gesture || gesture.getTaps() != expected.taps || t != expected.ms) {
+				printf("%s from %u: gesture %u with %u taps at %u ms, expected %u with %u taps at %u ms\n", timeline.name,
+					startMs, g, gesture.getTaps(), t, expected.gesture, expected.taps, expected.ms);
+				wrong++;
+			}
+		}
+		reported++;
+	}
+	if (reported < timeline.expectedCount) wrong++;
+	return wrong;
+}
+
+void testTimelines() {
+	
+	// Anywhere in time, across the wrap-around of the 16 bits times and of millis()
+	const uint32_t STARTS[] { 0, 1000, 64000, 65535, 200000, 0xFFFFFFFFUL - 2000 };
+	for (const Timeline& timeline : TIMELINES) {
+		unsigned int wrong = 0;
+		for (uint32_t start : STARTS) wrong += play(timeline, start);
+		CHECK_EQUAL(0, wrong);
+	}
+	
+}
+
+void testState() {
+	
+	// A few bytes for each button
+	CHECK(sizeof(Gesture) <= 4);
+	
+	// Idle polling reports nothing, and the taps are those of the last gesture
+	Gesture gesture;
+	gesture.init();
+	for (uint32_t ms = 0; ms < 100000; ms += 7) CHECK_EQUAL(Gesture::NONE, gesture.poll(ms, TAP_MS, HOLD_MS));
+	CHECK_EQUAL(0, gesture.getTaps());
+	
+}
+
+int main() {
+	
+	testTimelines();
+	testState();
+	
+	return testResult();
+	
+}
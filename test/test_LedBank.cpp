@@ -0,0 +1,213 @@
+// LedBank against Led: the same flashes and blinks light the LEDs at the same times, without digitalWrite().
+// The cost of refreshing nine LEDs in a main loop, as in clock-divider, is then measured on the computer.
+// Finally brightness and fades from the Timer2 interrupt: duty cycles, interrupt rate and cost, with no main loop.
+
+#include <chrono>
+
+#include "test.h"
+#include "lib/Led.cpp"
+#include "lib/LedBank.cpp"
+
+const byte LED_PINS[] { 2, 3, 4, 5, 6, 7, 8, 9, 10 }; // Driven by Led
+const byte BANK_PINS[] { 11, 12, 13, A0, A1, A2, A3, A4, A5 }; // Driven by LedBank
+const byte N = sizeof(LED_PINS);
+const unsigned int MIN_DURATION_MS = 50;
+
+Led led[N];
+byte bank[N];
+
+/**
+ * Run the main loop for the given time, a pass every millisecond, counting the times an LED of the
+ * bank doesn't match its Led
+ */
+void run(uint32_t ms, unsigned int& different) {
+	for (uint32_t t = 0; t < ms; t++) {
+		for (byte i = 0; i < N; i++) led[i].loop();
+		LedBank::loop();
+		for (byte i = 0; i < N; i++) {
+			if (Stub::getOutput(LED_PINS[i]) != Stub::getOutput(BANK_PINS[i])) different++;
+		}
+		Stub::advanceUs(1000);
+	}
+}
+
+void testSameLight() {
+	
+	// Steady, flashing with a minimum duration and blinking LEDs, as used in the modules
+	unsigned int different = 0;
+	led[0].on();
+	LedBank::on(bank[0]);
+	led[1].blink(120, 0.1);
+	LedBank::blink(bank[1], 120, 0.1);
+	led[2].blink(500);
+	LedBank::blink(bank[2], 500);
+	led[3].blink(1000, 0.25, true);
+	LedBank::blink(bank[3], 1000, 0.25, true);
+	uint32_t writes = Stub::digitalWrites;
+	for (unsigned int f = 0; f < 100; f++) {
+		for (byte i = 4; i < N; i++) {
+			led[i].flash();
+			LedBank::flash(bank[i]);
+		}
+		run(100 + f % 7, different);
+	}
+	writes = Stub::digitalWrites - writes;
+	CHECK_EQUAL(0, different);
+	
+	led[0].off();
+	LedBank::off(bank[0]);
+	run(1, different);
+	CHECK_EQUAL(0, different);
+	printf("Same light for %u ms, Led did %u digitalWrite()\n", millis(), writes);
+	
+}
+
+/**
+ * Time of a main loop refreshing all the LEDs with the given function, in ns on the computer
+ */
+template <class F>
+double benchmark(F refresh) {
+	const unsigned int LOOPS = 1000000;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int l = 0; l < LOOPS; l++) {
+		refresh();
+		if (l % 16 == 0) Stub::advanceUs(1000); // A pass every 60 us or so
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / LOOPS;
+}
+
+void testLoopCost() {
+	
+	// Idle: all LEDs off, nothing waiting
+	for (byte i = 0; i < N; i++) {
+		led[i].off();
+		LedBank::off(bank[i]);
+	}
+	Stub::advanceUs(1000000);
+	auto ledLoop = []() { for (byte i = 0; i < N; i++) led[i].loop(); };
+	auto bankLoop = []() { LedBank::loop(); };
+	uint32_t writes = Stub::digitalWrites;
+	double ledIdleNs = benchmark(ledLoop);
+	double bankIdleNs = benchmark(bankLoop);
+	CHECK_EQUAL(writes, Stub::digitalWrites);
+	
+	// Three LEDs blinking, as while waiting for sequences to stop in in-cv
+	for (byte i = 0; i < 3; i++) {
+		led[i].blink(120, 0.1);
+		LedBank::blink(bank[i], 120, 0.1);
+	}
+	writes = Stub::digitalWrites;
+	double ledBlinkNs = benchmark(ledLoop);
+	uint32_t ledWrites = Stub::digitalWrites - writes;
+	writes = Stub::digitalWrites;
+	double bankBlinkNs = benchmark(bankLoop);
+	CHECK_EQUAL(writes, Stub::digitalWrites);
+	CHECK(ledWrites >= 3 * 1000000);
+	
+	printf("Nine LEDs on the computer, idle: Led %.1f ns/loop, LedBank %.1f ns/loop\n", ledIdleNs, bankIdleNs);
+	printf("Three blinking: Led %.1f ns/loop and a digitalWrite() per blinking LED, LedBank %.1f ns/loop\n",
+		ledBlinkNs, bankBlinkNs);
+	
+}
+
+/**
+ * Sample the outputs of the bank every 4 us for the given time, without calling the main loop, returning the duty
+ * cycle of each LED, the number of timer interrupts (each one changes the compare value) and the shortest time
+ * between two of them
+ */
+void samplePwm(uint32_t us, double* duty, unsigned int& interrupts, uint32_t& shortestUs) {
+	unsigned int high[N];
+	memset(high, 0, sizeof(high));
+	interrupts = 0;
+	shortestUs = UINT32_MAX;
+	uint32_t lastUs = 0;
+	byte compare = OCR2A;
+	for (uint32_t t = 0; t < us; t += 4) {
+		Stub::advanceUs(4);
+		for (byte i = 0; i < N; i++) if (Stub::getOutput(BANK_PINS[i])) high[i]++;
+		if (OCR2A != compare) {
+			if (interrupts > 0) shortestUs = min(shortestUs, t - lastUs);
+			interrupts++;
+			lastUs = t;
+			compare = OCR2A;
+		}
+	}
+	for (byte i = 0; i < N; i++) duty[i] = high[i] * 4.0 / us;
+}
+
+void testPwm() {
+	
+	// Brightness levels on LEDs turned on, the others stay off whatever their brightness
+	const byte BRIGHTNESS[] { 0, 4, 32, 64, 128, 200, 255, 255, 128 };
+	for (byte i = 0; i < N; i++) {
+		LedBank::set(bank[i], i < 7);
+		LedBank::setBrightness(bank[i], BRIGHTNESS[i]);
+	}
+	LedBank::startPwm();
+	
+	// A whole number of cycles of the 6 planes, 2016 us each, with the main loop stalled
+	double duty[N];
+	unsigned int interrupts;
+	uint32_t shortestUs;
+	samplePwm(100 * 2016, duty, interrupts, shortestUs);
+	for (byte i = 0; i < N; i++) {
+		double expected = i < 7 ? (BRIGHTNESS[i] >> 2) / 63.0 : 0;
+		CHECK_NEAR(expected, duty[i], 0.01);
+	}
+	
+	// Fixed rate, whatever the number of LEDs: the shortest plane leaves 512 cycles between interrupts
+	CHECK_NEAR(600, interrupts, 1);
+	CHECK_EQUAL(32, shortestUs);
+	const unsigned int ISRS = 1000000;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int r = 0; r < ISRS; r++) LedBank::isr();
+	auto end = std::chrono::steady_clock::now();
+	printf("PWM: %u interrupts in %u us with no main loop, at least %u us apart, %.1f ns each on the computer\n",
+		interrupts, 100 * 2016, shortestUs, std::chrono::duration<double, std::nano>(end - start).count() / ISRS);
+	
+}
+
+void testFade() {
+	
+	// From off to full brightness in 510 ms, two steps of 1/256 per millisecond
+	LedBank::setBrightness(bank[0], 0);
+	LedBank::on(bank[0]);
+	LedBank::fade(bank[0], 255, 510);
+	double previous = 0;
+	unsigned int decreasing = 0;
+	for (unsigned int t = 0; t < 600; t += 30) {
+		for (byte l = 0; l < 30; l++) {
+			LedBank::loop();
+			Stub::advanceUs(1000);
+		}
+		double duty[N];
+		unsigned int interrupts;
+		uint32_t shortestUs;
+		LedBank::loop();
+		samplePwm(2016, duty, interrupts, shortestUs);
+		if (duty[0] < previous) decreasing++;
+		previous = duty[0];
+		if (t == 240) CHECK(duty[0] > 0.4 && duty[0] < 0.6); // Halfway at 270 ms, sampling included
+	}
+	CHECK_EQUAL(0, decreasing);
+	CHECK_NEAR(1, previous, 0.01);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	for (byte i = 0; i < N; i++) {
+		led[i].init(LED_PINS[i], i >= 4 ? MIN_DURATION_MS : 0);
+		bank[i] = LedBank::add(BANK_PINS[i], i >= 4 ? MIN_DURATION_MS : 0);
+	}
+	
+	testSameLight();
+	testLoopCost();
+	testPwm();
+	testFade();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,129 @@
+// PeriodEstimator on jittered clocks: the period stays within the jitter, a single late or missing edge and
+// bounces are rejected, tempo changes are followed after two intervals, across the wrap-around of micros().
+
+#include "test.h"
+#include "lib/PeriodEstimator.cpp"
+
+const uint32_t PERIOD_US = 125000; // 120 BPM
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number below the given maximum
+ */
+uint32_t randomUs(uint32_t max) {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % max;
+}
+
+/**
+ * Feed a number of edges with a period and a random jitter up to the given amount on each edge, starting one period
+ * after the given time. Returns the largest error of the estimated period, once three intervals have been measured.
+ */
+uint32_t feed(PeriodEstimator& estimator, uint32_t& us, uint32_t periodUs, unsigned int count, uint32_t jitterUs) {
+	uint32_t maxError = 0;
+	for (unsigned int e = 0; e < count; e++) {
+		us += periodUs;
+		uint32_t jitter = randomUs(2 * jitterUs + 1);
+		CHECK(estimator.update(us - jitterUs + jitter));
+		if (e >= 3) {
+			uint32_t period = estimator.get();
+			maxError = max(maxError, period > periodUs ? period - periodUs : periodUs - period);
+		}
+	}
+	return maxError;
+}
+
+void testJitter() {
+	
+	// Every interval is off by twice the jitter at most, so is the median
+	const uint32_t JITTER[] { 0, 100, 1000, 5000 };
+	for (byte j = 0; j < 4; j++) {
+		PeriodEstimator estimator;
+		estimator.init(10000);
+		CHECK_EQUAL(0, estimator.get());
+		uint32_t us = 0;
+		uint32_t maxError = feed(estimator, us, PERIOD_US, 10000, JITTER[j]);
+		CHECK(maxError <= 2 * JITTER[j]);
+		printf("Edges jittered by up to %u us: period off by %u us at most\n", JITTER[j], maxError);
+	}
+	
+}
+
+void testOutliers() {
+	
+	PeriodEstimator estimator;
+	estimator.init(10000);
+	uint32_t us = 0;
+	feed(estimator, us, PERIOD_US, 10, 0);
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	
+	// A late edge gives a long and a short interval, neither of them is the median
+	us += PERIOD_US;
+	estimator.update(us + 20000);
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	us += PERIOD_US;
+	estimator.update(us);
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	feed(estimator, us, PERIOD_US, 3, 0);
+	
+	// A missing edge gives a single long interval
+	us += 2 * PERIOD_US;
+	estimator.update(us);
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	feed(estimator, us, PERIOD_US, 3, 0);
+	
+	// Bounces closer than the minimum period are rejected and don't move the last edge
+	CHECK(!estimator.update(us + 1));
+	CHECK(!estimator.update(us + 9999));
+	CHECK_EQUAL(us, estimator.getLastUs());
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	feed(estimator, us, PERIOD_US, 3, 0);
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	
+}
+
+void testTempoChange() {
+	
+	// The new period is the median as soon as two intervals of it have been measured
+	PeriodEstimator estimator;
+	estimator.init(10000);
+	uint32_t us = 0;
+	feed(estimator, us, PERIOD_US, 10, 0);
+	feed(estimator, us, PERIOD_US / 2, 1, 0);
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	feed(estimator, us, PERIOD_US / 2, 1, 0);
+	CHECK_EQUAL(PERIOD_US / 2, estimator.get());
+	
+	// Until then, after a reset, the given period or the last interval
+	estimator.reset(PERIOD_US);
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	estimator.update(us);
+	CHECK_EQUAL(PERIOD_US, estimator.get());
+	feed(estimator, us, PERIOD_US * 2, 1, 0);
+	CHECK_EQUAL(PERIOD_US * 2, estimator.get());
+	
+}
+
+void testWrap() {
+	
+	// micros() wraps around every 71 minutes, intervals don't notice
+	PeriodEstimator estimator;
+	estimator.init(10000);
+	uint32_t us = 0xFFFFFFFFUL - 5 * PERIOD_US;
+	uint32_t maxError = feed(estimator, us, PERIOD_US, 20, 1000);
+	CHECK(us < 0xFFFFFFFFUL - 5 * PERIOD_US); // Wrapped
+	CHECK(maxError <= 2000);
+	
+}
+
+int main() {
+	
+	testJitter();
+	testOutliers();
+	testTempoChange();
+	testWrap();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,106 @@
+// Bit order of the shift register drivers: the bits sent by SR74HC595 with shiftOut() and by SR74HC595SPI over SPI
+// are fed to a model of a chain of 74HC595, whose outputs must show the written value, the lowest byte on the first
+// register, as SR74HC595::write() with MSBFIRST does.
+
+#include "test.h"
+#include "lib/SR74HC595.cpp"
+#include "lib/SR74HC595SPI.cpp"
+
+const byte DATA_PIN = A3;
+const byte CLOCK_PIN = A1;
+const byte LATCH_PIN = A2;
+const byte SPI_LATCH_PIN = 10;
+
+/**
+ * Outputs of a chain of registers after shifting in the given bytes, bits in the order they left the pin: each bit
+ * enters the first output (QA) of the first register, pushing the others forward, the last output (QH) of a register
+ * moving to the first output of the next one
+ */
+uint32_t chainOutputs(const uint8_t* bytes, unsigned int count) {
+	uint32_t chain = 0;
+	for (unsigned int b = 0; b < count; b++) {
+		for (int i = 7; i >= 0; i--) chain = (chain << 1) | ((bytes[b] >> i) & 1);
+	}
+	return chain;
+}
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number
+ */
+uint32_t randomNumber() {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) ^ (randomState << 16);
+}
+
+void testShiftOut() {
+	
+	// Every value ends on the outputs of a single register, with the latch left high
+	SR74HC595 shiftRegister;
+	shiftRegister.init(DATA_PIN, CLOCK_PIN, LATCH_PIN);
+	unsigned int errors = 0;
+	for (int value = 0; value < 256; value++) {
+		Stub::shiftedCount = 0;
+		shiftRegister.write(value);
+		if (Stub::shiftedCount != 1 || (chainOutputs(Stub::shifted, 1) & 0xFF) != value) errors++;
+		if (!Stub::getOutput(LATCH_PIN)) errors++;
+	}
+	CHECK_EQUAL(0, errors);
+	
+}
+
+/**
+ * Write random values to a chain of the given length, returning the wrong outputs
+ */
+template <byte LENGTH>
+unsigned int writeChain() {
+	SR74HC595SPI<LENGTH> chain;
+	chain.init(SPI_LATCH_PIN);
+	uint32_t mask = LENGTH < 4 ? (1UL << (8 * LENGTH)) - 1 : 0xFFFFFFFFUL;
+	unsigned int errors = 0;
+	for (unsigned int v = 0; v < 10000; v++) {
+		uint32_t value = v < 256 ? v : randomNumber();
+		SPI.transferredCount = 0;
+		chain.write(value);
+		if (SPI.transferredCount != LENGTH || chainOutputs(SPI.transferred, LENGTH) != (value & mask)) errors++;
+		if (!Stub::getOutput(SPI_LATCH_PIN)) errors++;
+	}
+	return errors;
+}
+
+void testSPI() {
+	
+	// A single register gets what SR74HC595 would shift out, for every value
+	SR74HC595 shiftRegister;
+	shiftRegister.init(DATA_PIN, CLOCK_PIN, LATCH_PIN);
+	SR74HC595SPI<1> spiRegister;
+	spiRegister.init(SPI_LATCH_PIN);
+	unsigned int different = 0;
+	for (int value = 0; value < 256; value++) {
+		Stub::shiftedCount = 0;
+		SPI.transferredCount = 0;
+		shiftRegister.write(value);
+		spiRegister.write(value);
+		if (SPI.transferredCount != 1 || SPI.transferred[0] != Stub::shifted[0]) different++;
+	}
+	CHECK_EQUAL(0, different);
+	
+	// Chains show the whole value, the lowest byte on the first register
+	CHECK_EQUAL(0, writeChain<1>());
+	CHECK_EQUAL(0, writeChain<2>());
+	CHECK_EQUAL(0, writeChain<3>());
+	CHECK_EQUAL(0, writeChain<4>());
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	
+	testShiftOut();
+	testSPI();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,135 @@
+// Deadline adherence of the Scheduler under main loop load, across the millis() overflow
+
+#include "test.h"
+#include "lib/Scheduler.cpp"
+
+const byte TASKS = 4;
+const unsigned long PERIODS[TASKS] { 10, 25, 100, 0 };
+
+byte tasks[TASKS];
+unsigned int runs[TASKS];
+unsigned long lateness[TASKS]; // Largest delay from the deadline, in milliseconds
+unsigned long deadlines[TASKS];
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number below the given maximum
+ */
+uint32_t randomUs(uint32_t max) {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % max;
+}
+
+/**
+ * Record a run of a task, and schedule the expected deadline of the next one
+ */
+void record(byte t) {
+	unsigned long late = millis() - deadlines[t];
+	if (late > lateness[t]) lateness[t] = late;
+	runs[t]++;
+	if (PERIODS[t] > 0) deadlines[t] += PERIODS[t];
+	if ((long)(millis() - deadlines[t]) >= 0) deadlines[t] = millis() + PERIODS[t];
+}
+
+void fast() {
+	record(0);
+}
+
+void medium() {
+	record(1);
+}
+
+void slow() {
+	record(2);
+	Stub::advanceUs(3000); // The longest task
+	Scheduler::start(tasks[3], 5);
+	deadlines[3] = millis() + 5;
+}
+
+void oneShot() {
+	record(3);
+}
+
+/**
+ * Run the main loop for the given time, each pass taking from 200 us up to the given maximum besides the tasks
+ */
+void run(unsigned long ms, uint32_t maxLoadUs) {
+	unsigned long start = millis();
+	while (millis() - start < ms) {
+		Scheduler::loop();
+		Stub::advanceUs(200 + randomUs(maxLoadUs - 200));
+	}
+}
+
+/**
+ * Clear the measurements
+ */
+void clear() {
+	for (byte t = 0; t < TASKS; t++) runs[t] = lateness[t] = 0;
+}
+
+void testDeadlines() {
+	
+	// Tasks by descending priority, the fastest first, across the millis() overflow
+	void (*functions[TASKS])() { fast, medium, slow, oneShot };
+	for (byte t = 0; t < TASKS; t++) {
+		tasks[t] = Scheduler::add(functions[t], PERIODS[t], TASKS - t);
+		deadlines[t] = millis() + PERIODS[t];
+	}
+	CHECK_EQUAL(TASKS, Scheduler::getCount());
+	CHECK(!Scheduler::isStarted(tasks[3]));
+	
+	unsigned long start = millis();
+	run(10005, 1000);
+	CHECK((long)(millis() - start) > 0 && millis() < start); // Wrapped
+	CHECK_EQUAL(1000, runs[0]);
+	CHECK_EQUAL(400, runs[1]);
+	CHECK_EQUAL(100, runs[2]);
+	CHECK_EQUAL(99, runs[3]); // The last one is still waiting
+	
+	// A task is delayed at most by the longest other task and a loop pass
+	for (byte t = 0; t < TASKS; t++) CHECK(lateness[t] <= 4);
+	CHECK(Scheduler::getMaxRunUs(tasks[2]) >= 3000 && Scheduler::getMaxRunUs(tasks[2]) < 3100);
+	printf("Deadlines under load (1 ms loop passes, a 3 ms task): largest delays %u, %u, %u, %u ms\n",
+		(unsigned int)lateness[0], (unsigned int)lateness[1], (unsigned int)lateness[2], (unsigned int)lateness[3]);
+	
+}
+
+void testSkippedRuns() {
+	
+	// After the main loop is blocked for five periods of the fast task, it runs once, not five times in a row
+	Stub::advanceUs(50000);
+	clear();
+	for (byte i = 0; i < 5; i++) Scheduler::loop();
+	CHECK_EQUAL(1, runs[0]);
+	
+	// And keeps its period from there
+	clear();
+	run(1000, 1000);
+	CHECK(runs[0] >= 99 && runs[0] <= 101);
+	
+}
+
+void testNothingDue() {
+	
+	// Stopped tasks never run
+	for (byte t = 0; t < TASKS; t++) Scheduler::stop(tasks[t]);
+	clear();
+	run(1000, 1000);
+	for (byte t = 0; t < TASKS; t++) CHECK_EQUAL(0, runs[t]);
+	CHECK(!Scheduler::loop());
+	
+}
+
+int main() {
+	
+	Stub::reset((uint64_t)(0xFFFFFFFFUL - 2000) * 1000); // millis() overflows in 2 s
+	
+	testDeadlines();
+	testSkippedRuns();
+	testNothingDue();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,102 @@
+// Euclidean rhythms of clock-divider (see config/clock-divider-euclidean.h): the default rhythms play the table of
+// fixed 8-step patterns they replaced, and the generated patterns are even, rotated and bounded for any parameters.
+
+#include "test.h"
+#include "clock-divider.cpp"
+
+// The patterns of the previous versions, one step per input pulse, starting from the first one
+const int TABLE[8][8] {
+	{ 1, 0, 0, 0, 0, 0, 0, 0 },
+	{ 1, 0, 0, 0, 1, 0, 0, 0 },
+	{ 1, 0, 0, 1, 0, 0, 1, 0 },
+	{ 1, 0, 1, 0, 1, 0, 1, 0 },
+	{ 0, 1, 1, 0, 1, 1, 0, 1 },
+	{ 0, 1, 1, 1, 0, 1, 1, 1 },
+	{ 0, 1, 1, 1, 1, 1, 1, 1 },
+	{ 1, 1, 1, 1, 1, 1, 1, 1 },
+};
+
+void testTable() {
+	
+	// Played on the outputs in trigger mode, for a few rounds of the patterns
+	unsigned int errors = 0;
+	for (byte p = 0; p < 32; p++) {
+		Stub::setInput(CLOCK_INPUT, HIGH);
+		for (byte i = 0; i < 8; i++) {
+			if (Stub::getOutput(DIVISIONS_OUTPUT[i]) != (TABLE[i][p % 8] == 1)) errors++;
+		}
+		Stub::advanceUs(5000);
+		Stub::setInput(CLOCK_INPUT, LOW);
+		Stub::advanceUs(5000);
+	}
+	CHECK_EQUAL(0, errors);
+	
+}
+
+/**
+ * Number of pulses in a pattern
+ */
+byte countPulses(unsigned long pattern) {
+	byte count = 0;
+	for (; pattern != 0; pattern &= pattern - 1) count++;
+	return count;
+}
+
+void testGenerator() {
+	
+	// Every pattern up to 32 steps has the requested pulses, no more than the steps, spread with gaps differing by
+	// one step at most, and rotations are rotations to the left
+	unsigned int uneven = 0;
+	unsigned int rotated = 0;
+	for (byte steps = 1; steps <= 32; steps++) {
+		for (byte pulses = 0; pulses <= 40; pulses++) {
+			unsigned long pattern = euclideanGenerate(steps, pulses, 0);
+			unsigned long mask = steps < 32 ? (1UL << steps) - 1 : 0xFFFFFFFFUL;
+			CHECK_EQUAL(min(pulses, steps), countPulses(pattern));
+			CHECK_EQUAL(0, pattern & ~mask);
+			if (pulses == 0 || pulses > steps) continue;
+			
+			// Gaps between consecutive pulses, around the loop
+			byte minGap = 255;
+			byte maxGap = 0;
+			byte first = 255;
+			byte last = 0;
+			for (byte s = 0; s < steps; s++) {
+				if ((pattern & (1UL << s)) == 0) continue;
+				if (first == 255) {
+					first = s;
+				} else {
+					minGap = min(minGap, (byte)(s - last));
+					maxGap = max(maxGap, (byte)(s - last));
+				}
+				last = s;
+			}
+			byte wrap = steps - last + first;
+			minGap = min(minGap, wrap);
+			maxGap = max(maxGap, wrap);
+			if (maxGap - minGap > 1) uneven++;
+			
+			for (byte rotation = 0; rotation < 40; rotation++) {
+				byte r = rotation % steps;
+				unsigned long expected = r == 0 ? pattern : ((pattern >> r) | (pattern << (steps - r))) & mask;
+				if (euclideanGenerate(steps, pulses, rotation) != expected) rotated++;
+			}
+		}
+	}
+	CHECK_EQUAL(0, uneven);
+	CHECK_EQUAL(0, rotated);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	Stub::setInput(RESET_BUTTON, LOW); // Not pressed
+	setup();
+	
+	testTable();
+	testGenerator();
+	
+	return testResult();
+	
+}
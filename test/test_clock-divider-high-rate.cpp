@@ -0,0 +1,52 @@
+// Simulation of clock-divider in high-rate mode (see config/clock-divider-high-rate.h): an audio-rate input is
+// divided into square waves in gate mode, and logic combinations are ignored as documented.
+
+#include "test.h"
+#include "clock-divider.cpp"
+
+const uint32_t PERIOD_US = 100; // 10 kHz input
+const uint32_t STEP_US = 10; // Resolution of the output sampling
+
+void testSquareWaves() {
+	
+	// Count the rising edges and the time spent high by each output, over a number of input periods multiple of
+	// every division
+	const unsigned int periods = 600;
+	unsigned int rises[4] { 0, 0, 0, 0 };
+	uint32_t highUs[4] { 0, 0, 0, 0 };
+	bool levels[4] { false, false, false, false };
+	for (unsigned int p = 0; p < periods; p++) {
+		for (uint32_t t = 0; t < PERIOD_US; t += STEP_US) {
+			if (t == 0 || t == PERIOD_US / 2) Stub::setInput(CLOCK_INPUT, t == 0);
+			if (t == 0 && p % 10 == 0) loop();
+			for (byte i = 0; i < 4; i++) {
+				bool level = Stub::getOutput(DIVISIONS_OUTPUT[i]);
+				if (level && !levels[i]) rises[i]++;
+				if (level) highUs[i] += STEP_US;
+				levels[i] = level;
+			}
+			Stub::advanceUs(STEP_US);
+		}
+	}
+	
+	// Plain divisions with a 50% duty cycle, also for the output configured with logic
+	CHECK_EQUAL(0, logicMask);
+	for (byte i = 0; i < 4; i++) {
+		CHECK_EQUAL(periods / DIVISIONS[i], rises[i]);
+		CHECK_EQUAL(periods * PERIOD_US / 2, highUs[i]);
+	}
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	Stub::setInput(RESET_BUTTON, LOW); // Not pressed
+	EEPROM.write(MODE_EEPROM_ADDRESS, 1); // Gate mode
+	setup();
+	
+	testSquareWaves();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,93 @@
+// Probability and logic outputs of clock-divider: the output programs combine the fired divisions as documented,
+// and cost little more per clock edge than plain divisions (measured on the computer, not on the module).
+
+#include <chrono>
+
+#include "test.h"
+#include "clock-divider.cpp"
+
+/**
+ * Send a number of input pulses, returning the rising edges of each output
+ */
+void pulse(unsigned int count, unsigned int* rises) {
+	for (byte i = 0; i < n; i++) rises[i] = 0;
+	for (unsigned int p = 0; p < count; p++) {
+		Stub::setInput(CLOCK_INPUT, HIGH);
+		for (byte i = 0; i < n; i++) {
+			if (Stub::getOutput(DIVISIONS_OUTPUT[i])) rises[i]++;
+		}
+		Stub::advanceUs(5000);
+		Stub::setInput(CLOCK_INPUT, LOW);
+		Stub::advanceUs(5000);
+	}
+}
+
+/**
+ * Set the program of an output
+ */
+void program(byte i, char op, byte a, byte b, byte threshold) {
+	outputPrograms[i].op = op;
+	outputPrograms[i].a = a;
+	outputPrograms[i].b = b;
+	outputPrograms[i].threshold = threshold;
+	if (op != 0) logicMask |= 1UL << i;
+}
+
+void testPrograms() {
+	
+	// Divisions by 2 and 3 on outputs 0 and 1, and by 4 on output 2: AND of 2 and 4 fires as 4, OR of 2 and 3 on
+	// 4 edges out of 6, XOR of 2 and 3 on 3 edges out of 6, and a division by 2 at 50% probability
+	program(3, '&', 0, 2, 255);
+	program(4, '|', 0, 1, 255);
+	program(5, '^', 0, 1, 255);
+	program(6, 0, 0, 0, 127);
+	unsigned int rises[32];
+	pulse(600, rises);
+	CHECK_EQUAL(300, rises[0]);
+	CHECK_EQUAL(200, rises[1]);
+	CHECK_EQUAL(150, rises[2]);
+	CHECK_EQUAL(150, rises[3]);
+	CHECK_EQUAL(400, rises[4]);
+	CHECK_EQUAL(300, rises[5]);
+	CHECK(rises[6] > 120 && rises[6] < 180);
+	printf("Division by 2 at 50%% probability: %u pulses out of 300\n", rises[6]);
+	
+}
+
+/**
+ * Host time of a clock edge, in nanoseconds, averaged over many edges (the simulated interrupt included)
+ */
+double edgeNs() {
+	const unsigned int edges = 200000;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int e = 0; e < edges; e++) Stub::setInput(CLOCK_INPUT, e % 2 == 0);
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / edges;
+}
+
+void testEdgeCost() {
+	
+	// Plain divisions on every output, then logic with probability on every output
+	for (byte i = 0; i < n; i++) program(i, 0, i, i, 255);
+	logicMask = 0;
+	double plain = edgeNs();
+	for (byte i = 0; i < n; i++) program(i, "&|^"[i % 3], i, (i + 1) % n, 200);
+	double logic = edgeNs();
+	printf("Clock edge on the computer, %u outputs: %.0f ns with plain divisions, %.0f ns with logic and probability\n",
+		n, plain, logic);
+	CHECK(logic > 0);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	Stub::setInput(RESET_BUTTON, LOW); // Not pressed
+	setup();
+	
+	testPrograms();
+	testEdgeCost();
+	
+	return testResult();
+	
+}
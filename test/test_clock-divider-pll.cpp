@@ -0,0 +1,132 @@
+// Simulation of clock-divider multiplications (see config/clock-divider-pll.h): the PLL locks to the last input
+// period, so the multiplied pulses must fall within a timer tick of the fractions of that period, while the
+// input tempo is swept, and the main loop computes the phase increments.
+
+#include "test.h"
+#include "clock-divider.cpp"
+
+const uint32_t PULSE_US = 5000; // Width of the input clock pulses
+const uint32_t STEP_US = 10; // Resolution of the output sampling
+
+uint32_t lastRise = 0; // Time of the last input rising edge
+uint32_t lastInterval = 0; // Last input period
+bool outputLevels[3];
+
+// Largest distance of the output rising edges from the fractions of the last input period, and of the current one
+uint32_t lockError[3];
+uint32_t tempoError[3];
+unsigned int rises[3];
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number below the given maximum
+ */
+uint32_t randomUs(uint32_t max) {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % max;
+}
+
+/**
+ * Distance of a time offset from the closest fraction of a period
+ */
+uint32_t distance(uint32_t offset, uint32_t period, byte m) {
+	uint32_t best = 0xFFFFFFFF;
+	for (byte k = 0; k < m; k++) {
+		uint32_t expected = period * k / m;
+		best = min(best, offset > expected ? offset - expected : expected - offset);
+	}
+	return best;
+}
+
+/**
+ * Run the input clock for a number of pulses, from a period changing by the given amount each pulse, calling the
+ * main loop at random intervals up to the given maximum. Returns the last period.
+ */
+uint32_t run(uint32_t period, int32_t sweep, unsigned int count, uint32_t maxLoadUs, bool check) {
+	
+	uint32_t nextLoop = micros();
+	for (unsigned int p = 0; p < count; p++, period += sweep) {
+		for (uint32_t t = 0; t < period; t += STEP_US) {
+			if (t == 0 || t == PULSE_US) {
+				Stub::setInput(CLOCK_INPUT, t == 0);
+				if (t == 0) {
+					lastInterval = micros() - lastRise;
+					lastRise = micros();
+				}
+			}
+			if ((int32_t)(micros() - nextLoop) >= 0) {
+				loop();
+				nextLoop = micros() + 200 + randomUs(maxLoadUs);
+			}
+			for (byte i = 0; i < 3; i++) {
+				bool level = Stub::getOutput(DIVISIONS_OUTPUT[i]);
+				if (level && !outputLevels[i] && check) {
+					byte m = -DIVISIONS[i];
+					uint32_t offset = micros() - lastRise;
+					lockError[i] = max(lockError[i], distance(offset, lastInterval, m));
+					tempoError[i] = max(tempoError[i], distance(offset, period, m));
+					rises[i]++;
+				}
+				outputLevels[i] = level;
+			}
+			Stub::advanceUs(STEP_US);
+		}
+	}
+	return period;
+	
+}
+
+/**
+ * Clear the measurements
+ */
+void clear() {
+	for (byte i = 0; i < 3; i++) lockError[i] = tempoError[i] = rises[i] = 0;
+}
+
+void testSteadyClock() {
+	
+	// Division by one until the input period is known
+	run(100000, 0, 3, 2000, false);
+	CHECK_EQUAL(100000, pllInterval);
+	
+	clear();
+	run(100000, 0, 20, 2000, true);
+	for (byte i = 0; i < 3; i++) {
+		CHECK_EQUAL(20 * -DIVISIONS[i], rises[i]);
+		CHECK(lockError[i] <= SCHEDULER_TICK_US);
+	}
+	printf("Multiplications at 100 ms: errors %u, %u, %u us\n", lockError[0], lockError[1], lockError[2]);
+	
+}
+
+void testSweptTempo() {
+	
+	// Tempo sweeping from 100 ms to 50 ms and back, by 1 ms each pulse: the PLL follows the last period, so the
+	// error from the current one is up to the change of one pulse
+	clear();
+	uint32_t period = run(100000, -1000, 50, 2000, true);
+	run(period, 1000, 50, 2000, true);
+	for (byte i = 0; i < 3; i++) {
+		CHECK_EQUAL(100 * -DIVISIONS[i], rises[i]);
+		CHECK(lockError[i] <= SCHEDULER_TICK_US);
+		CHECK(tempoError[i] <= 1000 + SCHEDULER_TICK_US);
+	}
+	printf("Multiplications, tempo swept by 1 ms each pulse: errors %u, %u, %u us from the last period, "
+		"%u, %u, %u us from the current one\n",
+		lockError[0], lockError[1], lockError[2], tempoError[0], tempoError[1], tempoError[2]);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	Stub::setInput(RESET_BUTTON, LOW); // Not pressed
+	setup();
+	
+	testSteadyClock();
+	testSweptTempo();
+	
+	return testResult();
+	
+}
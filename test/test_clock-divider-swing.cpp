@@ -0,0 +1,126 @@
+// Simulation of clock-divider swing and ratchets (see config/clock-divider-swing.h): the pulses scheduled from
+// the timer ISR must follow the input clock within a scheduler tick, whatever the main loop does, and follow
+// tempo changes once the main loop has computed the new delays.
+
+#include "test.h"
+#include "clock-divider.cpp"
+
+const uint32_t PULSE_US = 5000; // Width of the input clock pulses
+const uint32_t STEP_US = 10; // Resolution of the output sampling
+
+uint32_t lastRise = 0; // Time of the last input rising edge
+bool outputLevels[4];
+
+// Largest distance of the output rising edges from their expected offsets, after the last input rising edge
+uint32_t deviation[4];
+unsigned int rises[4];
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number below the given maximum
+ */
+uint32_t randomUs(uint32_t max) {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % max;
+}
+
+/**
+ * Distance of a time offset from the closest of the expected ones
+ */
+uint32_t distance(uint32_t offset, const uint32_t* expected, byte count) {
+	uint32_t best = 0xFFFFFFFF;
+	for (byte i = 0; i < count; i++) {
+		uint32_t d = offset > expected[i] ? offset - expected[i] : expected[i] - offset;
+		best = min(best, d);
+	}
+	return best;
+}
+
+/**
+ * Run the input clock with the given period for a number of pulses, calling the main loop at random intervals
+ * up to the given maximum, and checking the output rising edges against the offsets expected for the period
+ */
+void run(uint32_t period, unsigned int count, uint32_t maxLoadUs, bool check) {
+	
+	// Swung output: on the beat, or delayed by 25% of the divided period, i.e. half an input period.
+	// Ratcheted outputs: three pulses in one input period, or in four input periods.
+	const uint32_t ratchet[] { 0, period / 3, period * 2 / 3 };
+	const uint32_t swing[] { 0, period / 2 };
+	const uint32_t ratchetDivided[] { 0, period * 4 / 3 - period, period * 8 / 3 - 2 * period };
+	
+	uint32_t nextLoop = micros();
+	for (unsigned int p = 0; p < count; p++) {
+		for (uint32_t t = 0; t < period; t += STEP_US) {
+			if (t == 0 || t == PULSE_US) {
+				Stub::setInput(CLOCK_INPUT, t == 0);
+				if (t == 0) lastRise = micros();
+			}
+			if ((int32_t)(micros() - nextLoop) >= 0) {
+				loop();
+				nextLoop = micros() + 200 + randomUs(maxLoadUs);
+			}
+			for (byte i = 0; i < 4; i++) {
+				bool level = Stub::getOutput(DIVISIONS_OUTPUT[i]);
+				if (level && !outputLevels[i] && check) {
+					uint32_t offset = micros() - lastRise;
+					uint32_t d = 0;
+					if (i == 0) d = distance(offset, ratchet, 3);
+					if (i == 1) d = offset;
+					if (i == 2) d = distance(offset, swing, 2);
+					if (i == 3) d = distance(offset, ratchetDivided, 3);
+					deviation[i] = max(deviation[i], d);
+					rises[i]++;
+				}
+				outputLevels[i] = level;
+			}
+			Stub::advanceUs(STEP_US);
+		}
+	}
+	
+}
+
+void testSteadyClock() {
+	
+	// Measure the input period first
+	run(100000, 4, 5000, false);
+	CHECK_EQUAL(100000, pulsesPeriod);
+	
+	// Loop load doesn't matter, the pulses are scheduled from the ISRs on the delays computed once
+	for (byte i = 0; i < 4; i++) deviation[i] = rises[i] = 0;
+	run(100000, 40, 20000, true);
+	CHECK_EQUAL(120, rises[0]);
+	CHECK_EQUAL(20, rises[1]);
+	CHECK_EQUAL(20, rises[2]);
+	CHECK_EQUAL(30, rises[3]);
+	for (byte i = 0; i < 4; i++) CHECK(deviation[i] <= SCHEDULER_TICK_US);
+	printf("Swing and ratchets at 100 ms, loop load up to 20 ms: deviations %u, %u, %u, %u us\n",
+		deviation[0], deviation[1], deviation[2], deviation[3]);
+	
+}
+
+void testTempoChange() {
+	
+	// Faster input clock: the period is the median of the last three intervals, then the loop computes the delays
+	run(50000, 8, 1000, false);
+	CHECK_EQUAL(50000, pulsesPeriod);
+	for (byte i = 0; i < 4; i++) deviation[i] = rises[i] = 0;
+	run(50000, 40, 1000, true);
+	for (byte i = 0; i < 4; i++) CHECK(deviation[i] <= SCHEDULER_TICK_US);
+	printf("Swing and ratchets at 50 ms: deviations %u, %u, %u, %u us\n",
+		deviation[0], deviation[1], deviation[2], deviation[3]);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	Stub::setInput(RESET_BUTTON, LOW); // Not pressed
+	setup();
+	
+	testSteadyClock();
+	testTempoChange();
+	
+	return testResult();
+	
+}
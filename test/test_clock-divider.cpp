@@ -0,0 +1,104 @@
+// Stress test of the clock-divider clock ISR: random clock edges and resets, in trigger and gate mode, checking
+// every output against a plain counter model right after each edge, and the edge queue read by the main loop.
+
+#include <chrono>
+
+#include "test.h"
+#include "clock-divider.cpp"
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number below the given maximum
+ */
+uint32_t randomNumber(uint32_t max) {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % max;
+}
+
+/**
+ * Expected output level of a division, given the input pulses counted from the down-beat (zero on the down-beat)
+ */
+bool expected(byte i, unsigned long count, bool clock) {
+	int d = DIVISIONS[i];
+	unsigned int counter = count % d;
+	if (!gateMode) return clock && counter == 0;
+	unsigned int half = d / 2;
+	return counter < half || (d % 2 != 0 && counter == half && clock);
+}
+
+/**
+ * Send a number of random clock pulses, starting with a reset and then a reset every hundred pulses on average,
+ * and the main loop called every few edges, checking the outputs right after each edge, before any time has passed.
+ * Returns the wrong outputs.
+ */
+unsigned int pulse(unsigned long count) {
+	unsigned int errors = 0;
+	uint32_t writes = Stub::digitalWrites;
+	uint32_t loopIn = randomNumber(14);
+	unsigned long beat = 0;
+	for (unsigned long p = 0; p < count; p++) {
+		bool reset = p == 0 || randomNumber(100) == 0;
+		if (reset) {
+			Stub::setInput(RESET_INPUT, HIGH);
+			Stub::setInput(RESET_INPUT, LOW);
+		}
+		for (byte edge = 0; edge < 2; edge++) {
+			bool clock = edge == 0;
+			Stub::setInput(CLOCK_INPUT, clock);
+			if (clock) beat = reset ? 0 : beat + 1;
+			for (byte i = 0; i < n; i++) {
+				if (Stub::getOutput(DIVISIONS_OUTPUT[i]) != expected(i, beat, clock)) errors++;
+			}
+			Stub::advanceUs(100 + randomNumber(1000));
+			if (loopIn-- == 0) {
+				CHECK_EQUAL(writes, Stub::digitalWrites); // Outputs are written to the port registers, not by pin
+				loop();
+				writes = Stub::digitalWrites;
+				loopIn = randomNumber(14);
+			}
+		}
+	}
+	return errors;
+}
+
+void testDivisions() {
+	
+	// Any division, in both modes, the main loop draining the edges every 14 edges at most
+	CHECK_EQUAL(0, pulse(100000));
+	gateMode = true;
+	CHECK_EQUAL(0, pulse(100000));
+	gateMode = false;
+	CHECK_EQUAL(0, clockEdges.getOverflows());
+	
+	// Edges are dropped and counted only if the main loop doesn't drain them for more than 15 edges
+	loop();
+	for (byte e = 0; e < 20; e++) Stub::setInput(CLOCK_INPUT, e % 2 == 0);
+	CHECK_EQUAL(5, clockEdges.getOverflows());
+	
+}
+
+void testEdgeTime() {
+	
+	// Outputs change with the edge in the simulation, the ISR takes no simulated time: measure it on the computer
+	const unsigned int edges = 200000;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int e = 0; e < edges; e++) Stub::setInput(CLOCK_INPUT, e % 2 == 0);
+	auto end = std::chrono::steady_clock::now();
+	printf("Clock edge on the computer, %u divisions: %.0f ns (simulated interrupt included)\n",
+		n, std::chrono::duration<double, std::nano>(end - start).count() / edges);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	Stub::setInput(RESET_BUTTON, LOW); // Not pressed
+	setup();
+	
+	testDivisions();
+	testEdgeTime();
+	
+	return testResult();
+	
+}
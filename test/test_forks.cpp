@@ -0,0 +1,101 @@
+// Simulation of forks: outcomes are decided in the input ISR against the probability threshold cached by the main
+// loop, from knobs and CVs read in background by the ADC scanner, so outputs follow input edges at once.
+
+#include <chrono>
+
+#include "test.h"
+#include "forks.cpp"
+
+/**
+ * Run the main loop for the given time, a pass every millisecond
+ */
+void run(unsigned long ms) {
+	for (unsigned long i = 0; i < ms; i++) {
+		loop();
+		Stub::advanceUs(1000);
+	}
+}
+
+/**
+ * Send input pulses to the first channel, checking that an output follows each edge before any time passes,
+ * with the main loop called only every few pulses. Returns the outcomes B.
+ */
+unsigned long pulse(unsigned long count, unsigned long& late) {
+	unsigned long b = 0;
+	for (unsigned long p = 0; p < count; p++) {
+		Stub::setInput(INPUTS[0], HIGH);
+		bool a = Stub::getOutput(OUTPUTS_A[0]);
+		bool outcomeB = Stub::getOutput(OUTPUTS_B[0]);
+		if (a == outcomeB) late++; // Exactly one output must be high
+		if (outcomeB) b++;
+		Stub::advanceUs(2000);
+		Stub::setInput(INPUTS[0], LOW);
+		if (Stub::getOutput(OUTPUTS_A[0]) || Stub::getOutput(OUTPUTS_B[0])) late++;
+		Stub::advanceUs(2000);
+		if (p % 4 == 0) loop();
+	}
+	return b;
+}
+
+void testProbability() {
+	
+	// Knob halfway, CV in the middle of its range so that it adds nothing
+	unsigned long late = 0;
+	unsigned long b = pulse(20000, late);
+	CHECK_EQUAL(0, late);
+	CHECK(b > 9400 && b < 10600);
+	printf("Knob halfway: %u outcomes B out of 20000, %u outputs not following the input at once\n", (unsigned int)b, (unsigned int)late);
+	
+	// Knob to the minimum and maximum: the threshold follows in background, then outcomes are certain
+	const int KNOB[] { 0, 1023 };
+	for (byte k = 0; k < 2; k++) {
+		Stub::setAnalog(PROBABILITY_KNOBS[0], KNOB[k]);
+		unsigned long ms = 0;
+		unsigned long target = KNOB[k] == 0 ? 0 : 65536;
+		while (probabilityThresholds[0] != target && ms < 1000) {
+			run(1);
+			ms++;
+		}
+		CHECK_EQUAL(target, probabilityThresholds[0]);
+		b = pulse(1000, late);
+		CHECK_EQUAL(KNOB[k] == 0 ? 0 : 1000, b);
+		CHECK_EQUAL(0, late);
+		printf("Knob to %d: threshold updated after %u ms\n", KNOB[k], (unsigned int)ms);
+	}
+	
+}
+
+void testEdgeTime() {
+	
+	// The ISR takes no simulated time: measure it on the computer
+	const unsigned int edges = 200000;
+	auto start = std::chrono::steady_clock::now();
+	for (unsigned int e = 0; e < edges; e++) Stub::setInput(INPUTS[0], e % 2 == 0);
+	auto end = std::chrono::steady_clock::now();
+	printf("Input edge on the computer: %.0f ns (simulated interrupt included)\n",
+		std::chrono::duration<double, std::nano>(end - start).count() / edges);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	
+	// Buttons not pressed (pulled up), toggle and latch switches off, knobs halfway, CVs at 0.5 once inverted
+	for (byte i = 0; i < 2; i++) {
+		Stub::setInput(INPUT_BUTTONS[i], HIGH);
+		Stub::setInput(MODE_TOGGLE_PINS[i], LOW);
+		Stub::setInput(MODE_LATCH_PINS[i], LOW);
+		Stub::setAnalog(PROBABILITY_KNOBS[i], 512);
+		Stub::setAnalog(PROBABILITY_CV_INPUTS[i], 338);
+	}
+	setup();
+	run(100);
+	CHECK(probabilityThresholds[0] > 32768 - 100 && probabilityThresholds[0] < 32768 + 100);
+	
+	testProbability();
+	testEdgeTime();
+	
+	return testResult();
+	
+}
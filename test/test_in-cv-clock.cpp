@@ -0,0 +1,238 @@
+// Simulation of the in-cv clock: internal clock jitter under loop load, handover to an external clock,
+// a missing external pulse, an external clock plugged back in, slower than the internal one, and the step
+// timing over thousands of pulses.
+
+#include "test.h"
+#include "in-cv.cpp"
+
+const uint32_t PULSE_US = 5000; // Width of the external clock pulses
+
+// External clock pulses, as rising edge times, raised and lowered while the time moves
+uint64_t pulses[4000];
+unsigned int pulsesCount = 0;
+unsigned int edgesDone = 0; // Two edges for each pulse
+
+// Clock pulses seen by the sequencer, as timestamps taken in the ISRs
+uint32_t seen[4000];
+unsigned int seenCount = 0;
+unsigned long seenClockCount = 0;
+
+// Passes where the sequence is waiting for a clock on its last step
+unsigned int phaseStuckCount = 0;
+
+// Steps played by the first performer, and the largest delay of a step from its exact fraction of the clock period
+unsigned int stepsPlayed = 0;
+uint32_t stepMaxDelay = 0;
+unsigned int lastPlayhead = 0;
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number below the given maximum
+ */
+uint32_t randomUs(uint32_t max) {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % max;
+}
+
+/**
+ * Move the time forward, raising and lowering the clock input on the scheduled pulses
+ */
+void advance(uint32_t us) {
+	uint64_t end = Stub::timeUs() + us;
+	while (edgesDone < 2 * pulsesCount) {
+		uint64_t edge = pulses[edgesDone / 2] + (edgesDone % 2 == 0 ? 0 : PULSE_US);
+		if (edge > end) break;
+		if (edge > Stub::timeUs()) Stub::advanceUs(edge - Stub::timeUs());
+		Stub::setInput(CLOCK_INPUT, edgesDone % 2 == 0);
+		edgesDone++;
+	}
+	Stub::advanceUs(end - Stub::timeUs());
+}
+
+/**
+ * Run the main loop until the given time, each pass taking from 200 us up to the given maximum
+ */
+void run(uint64_t untilUs, uint32_t maxLoadUs) {
+	while (Stub::timeUs() < untilUs) {
+		loop();
+		if (clockCount != seenClockCount) {
+			seenClockCount = clockCount;
+			if (seenCount < 4000) seen[seenCount++] = clockLastTime;
+		}
+		if (stepTime > 0 && micros() - clockLastTime >= clockPeriod.get()) {
+			phaseStuckCount++;
+		}
+		if (sequencePlayhead[0] != lastPlayhead) {
+			lastPlayhead = sequencePlayhead[0];
+			stepsPlayed++;
+			uint32_t elapsed = micros() - clockLastTime;
+			uint32_t stepStart = (uint64_t)(elapsed * CLOCK_DURATION / clockPeriod.get()) * clockPeriod.get() / CLOCK_DURATION;
+			stepMaxDelay = max(stepMaxDelay, elapsed - stepStart);
+		}
+		advance(min((uint64_t)(200 + randomUs(maxLoadUs)), untilUs - Stub::timeUs()));
+	}
+}
+
+/**
+ * Schedule external pulses from a time, with a period and a random jitter up to the given amount
+ */
+void schedule(uint64_t fromUs, uint32_t periodUs, unsigned int count, uint32_t jitterUs = 0) {
+	for (unsigned int i = 0; i < count && pulsesCount < 4000; i++) {
+		uint32_t jitter = jitterUs > 0 ? randomUs(2 * jitterUs) : 0;
+		pulses[pulsesCount++] = fromUs + (uint64_t)i * periodUs + jitter - jitterUs;
+	}
+}
+
+/**
+ * Return the largest deviation of the intervals between the pulses seen from the given index, from a period
+ */
+uint32_t maxDeviation(unsigned int from, unsigned int to, uint32_t periodUs) {
+	uint32_t deviation = 0;
+	for (unsigned int i = from + 1; i < to; i++) {
+		uint32_t interval = seen[i] - seen[i - 1];
+		deviation = max(deviation, interval > periodUs ? interval - periodUs : periodUs - interval);
+	}
+	return deviation;
+}
+
+void testInternalClock() {
+	
+	// No external clock: after the boot, the internal clock runs at the configured tempo
+	const uint32_t period = (60000000UL * 4 / INTERNAL_CLOCK_BPM) / CLOCK_RESOLUTION;
+	uint64_t start = Stub::timeUs();
+	run(start + 200 * (uint64_t)period + period / 2, 20000); // Up to 20 ms of loop load
+	CHECK(clockInternal);
+	CHECK_EQUAL(200, seenCount);
+	
+	// Timestamped from the Timer1 interrupt, so loop load adds no jitter: Timer1 counts every 4 us at this period
+	uint32_t deviation = maxDeviation(1, seenCount, period);
+	CHECK(deviation <= 4);
+	printf("Internal clock, 120 BPM, loop load up to 20 ms: %u pulses, largest jitter %u us\n", seenCount, deviation);
+	
+}
+
+void testExternalClock() {
+	
+	// An external clock at a different tempo takes over: its first pulse stops the internal clock
+	const uint32_t period = 100000;
+	uint64_t start = Stub::timeUs() + 30000;
+	unsigned int seenBefore = seenCount;
+	unsigned int stuckBefore = phaseStuckCount;
+	schedule(start, period, 100, 1000); // 1 ms of jitter
+	run(start + 10000, 5000);
+	CHECK(!clockInternal);
+	CHECK_EQUAL(seenBefore + 1, seenCount);
+	
+	// Steps keep moving at the internal tempo until the external one is measured, no freeze
+	CHECK(clockPeriod.get() > 0);
+	run(start + period - 2000, 5000);
+	CHECK_EQUAL(stuckBefore, phaseStuckCount);
+	
+	// Then follow the external clock, one step advance per pulse, with no pulse from the internal clock
+	run(start + 100 * (uint64_t)period - period / 2, 20000);
+	CHECK(!clockInternal);
+	CHECK_EQUAL(seenBefore + 100, seenCount);
+	CHECK(clockPeriod.get() >= period - 2000 && clockPeriod.get() <= period + 2000);
+	uint32_t deviation = maxDeviation(seenBefore + 1, seenCount, period);
+	CHECK(deviation <= 2000); // The input jitter only, loop load adds nothing
+	printf("External clock, 100 ms with 1 ms jitter, loop load up to 20 ms: largest deviation %u us\n", deviation);
+	
+}
+
+void testMissingPulse() {
+	
+	// A missing pulse: the internal clock takes over two periods after the last pulse, at the external tempo
+	const uint32_t period = 100000;
+	uint64_t start = Stub::timeUs() + period / 3;
+	schedule(start, period, 10);
+	uint64_t last = start + 9 * (uint64_t)period; // The 11th pulse is missing
+	run(last + period / 2, 5000);
+	CHECK(!clockInternal);
+	unsigned int seenBefore = seenCount;
+	run(last + 2 * period - 10000, 5000);
+	CHECK(!clockInternal); // Still waiting
+	CHECK_EQUAL(seenBefore, seenCount);
+	run(last + 2 * period + 10000, 5000);
+	CHECK(clockInternal);
+	CHECK_EQUAL(seenBefore + 1, seenCount); // First internal pulse right away
+	CHECK(clockInternalPeriod >= period - 100 && clockInternalPeriod <= period + 100);
+	
+	// The internal clock keeps the tempo
+	run(last + 12 * (uint64_t)period + period / 2, 5000);
+	CHECK(clockInternal);
+	CHECK_EQUAL(seenBefore + 11, seenCount);
+	uint32_t deviation = maxDeviation(seenBefore, seenCount, clockInternalPeriod);
+	CHECK(deviation <= 4);
+	printf("Missing external pulse: internal clock after %u us, largest jitter %u us\n", seen[seenBefore] - seen[seenBefore - 1], deviation);
+	
+}
+
+void testSlowerClockPluggedBack() {
+	
+	// An external clock much slower than the internal one (100 ms) is plugged back in: it must lock,
+	// the internal clock not restarting between its first two pulses
+	const uint32_t period = 400000;
+	uint64_t start = Stub::timeUs() + 30000;
+	schedule(start, period, 20);
+	unsigned int stuckBefore = phaseStuckCount;
+	run(start + 10000, 5000);
+	unsigned int seenBefore = seenCount;
+	CHECK(!clockInternal);
+	
+	// Steps move at the internal tempo until the second pulse, where they wait for it
+	run(start + 50000, 5000);
+	CHECK_EQUAL(stuckBefore, phaseStuckCount);
+	run(start + 20 * (uint64_t)period - period / 2, 5000);
+	CHECK(!clockInternal);
+	CHECK_EQUAL(seenBefore + 19, seenCount); // Exactly one pulse each, none from the internal clock
+	CHECK_EQUAL(period, clockPeriod.get());
+	CHECK_EQUAL(0, maxDeviation(seenBefore, seenCount, period));
+	
+	// Unplugged again, the internal clock takes over at the new tempo
+	run(start + 22 * (uint64_t)period, 5000);
+	CHECK(clockInternal);
+	CHECK_EQUAL(period, clockInternalPeriod);
+	
+}
+
+void testStepDrift() {
+	
+	// An external clock whose steps last 31250.5 us, which integer milliseconds would truncate to 31 ms: the
+	// playhead moves exactly CLOCK_DURATION steps each pulse, each step starting on time, after thousands of pulses
+	const uint32_t period = 62501;
+	const unsigned int count = 3000;
+	uint64_t start = Stub::timeUs() + 10000;
+	schedule(start, period, count);
+	run(start + 5 * (uint64_t)period - period / 4, 1000); // Locked
+	CHECK(!clockInternal);
+	CHECK_EQUAL(period, clockPeriod.get());
+	stepsPlayed = 0;
+	stepMaxDelay = 0;
+	run(start + (count - 1) * (uint64_t)period + period * 3 / 4, 1000);
+	CHECK_EQUAL((count - 5) * CLOCK_DURATION, stepsPlayed);
+	CHECK(stepMaxDelay <= 1200); // A loop pass, no accumulated error
+	printf("Step timing over %u pulses of %u us: %u steps, largest delay %u us\n", count, period, stepsPlayed, stepMaxDelay);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	
+	// Buttons not pressed, pulled up
+	for (byte p = 0; p < sizeof(PERFORMER_BUTTONS); p++) Stub::setInput(PERFORMER_BUTTONS[p], HIGH);
+	Stub::setInput(RESET_BUTTON, HIGH);
+	
+	setup();
+	CHECK(!calibrating);
+	
+	testInternalClock();
+	testExternalClock();
+	testMissingPulse();
+	testSlowerClockPluggedBack();
+	testStepDrift();
+	
+	return testResult();
+	
+}
@@ -0,0 +1,100 @@
+// Output frames of in-cv: in each pass of the main loop, each DAC is written once at most and the gates shift
+// register once at most, after the DACs, with the gates of the sequences. The cost of a commit is counted in bytes
+// on the I2C bus and pin writes, and estimated from them.
+
+#include "test.h"
+#include "in-cv.cpp"
+
+const double I2C_BYTE_US = 9 / 0.4; // 8 bits and the acknowledge at 400 kHz
+const double DIGITAL_WRITE_US = 4; // About, on an ATmega328P at 16 MHz
+
+uint32_t randomState = 1;
+
+/**
+ * Pseudo-random number below the given maximum
+ */
+uint32_t randomNumber(uint32_t max) {
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % max;
+}
+
+void testFrames() {
+	
+	// The internal clock plays the sequences, a random performer advances every couple of seconds,
+	// each button press lasting 100 ms
+	unsigned long passes = 0;
+	unsigned long cvPasses = 0;
+	unsigned long gatePasses = 0;
+	unsigned long bothPasses = 0;
+	unsigned int errors = 0;
+	uint32_t maxBytes = 0;
+	uint32_t maxWrites = 0;
+	int pressed = -1;
+	uint64_t pressTime = Stub::timeUs();
+	for (uint64_t end = Stub::timeUs() + 120000000ULL; Stub::timeUs() < end; ) {
+		
+		if (pressed < 0 && Stub::timeUs() >= pressTime) {
+			pressed = randomNumber(n);
+			Stub::setInput(PERFORMER_BUTTONS[pressed], LOW);
+		} else if (pressed >= 0 && Stub::timeUs() >= pressTime + 100000) {
+			Stub::setInput(PERFORMER_BUTTONS[pressed], HIGH);
+			pressed = -1;
+			pressTime = Stub::timeUs() + 1000000 + randomNumber(2000000);
+		}
+		
+		uint32_t transmissions = Wire.transmissions;
+		uint32_t bytes = Wire.bytesWritten;
+		uint32_t writes = Stub::digitalWrites;
+		Stub::shiftedCount = 0;
+		loop();
+		passes++;
+		transmissions = Wire.transmissions - transmissions;
+		bytes = Wire.bytesWritten - bytes;
+		writes = Stub::digitalWrites - writes;
+		
+		if (transmissions > 2) errors++; // A single write for each DAC
+		if (Stub::shiftedCount > 1) errors++; // A single write for the shift register
+		if (Stub::shiftedCount == 1) {
+			if (Stub::shiftedAfterTransmissions[0] != Wire.transmissions) errors++; // Gates after CVs
+			byte gates = 0;
+			for (byte p = 0; p < n; p++) if (sequenceLastGate[p]) bitSet(gates, p);
+			if (Stub::shifted[0] != gates) errors++;
+		}
+		if (transmissions > 0) cvPasses++;
+		if (Stub::shiftedCount > 0) gatePasses++;
+		if (transmissions > 0 && Stub::shiftedCount > 0) bothPasses++;
+		maxBytes = max(maxBytes, bytes);
+		maxWrites = max(maxWrites, writes);
+		
+		Stub::advanceUs(200 + randomNumber(1000));
+		
+	}
+	CHECK_EQUAL(0, errors);
+	CHECK(cvPasses > 1000);
+	CHECK(gatePasses > 1000);
+	CHECK(bothPasses > 100);
+	CHECK(maxBytes <= 2 * 9); // Address and 8 data bytes for each DAC
+	CHECK(maxWrites <= 8 * 3 + 2); // Data, clock high and low for each bit, latch low and high
+	printf("%u passes, %u with CVs written, %u with gates written, %u with both\n",
+		(unsigned int)passes, (unsigned int)cvPasses, (unsigned int)gatePasses, (unsigned int)bothPasses);
+	printf("Largest commit: %u bytes on I2C and %u pin writes, about %.0f us\n",
+		maxBytes, maxWrites, maxBytes * I2C_BYTE_US + maxWrites * DIGITAL_WRITE_US);
+	
+}
+
+int main() {
+	
+	Stub::reset();
+	
+	// Buttons not pressed, pulled up
+	for (byte p = 0; p < sizeof(PERFORMER_BUTTONS); p++) Stub::setInput(PERFORMER_BUTTONS[p], HIGH);
+	Stub::setInput(RESET_BUTTON, HIGH);
+	
+	setup();
+	CHECK(!calibrating);
+	
+	testFrames();
+	
+	return testResult();
+	
+}
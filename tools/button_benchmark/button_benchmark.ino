@@ -0,0 +1,76 @@
+// BUTTONS BENCHMARK =========================================================
+//
+// Compares the cost of reading the buttons of a main loop with one Button
+// object for each button, versus the ButtonBank debounced on the timer tick.
+// Seven buttons are read with readShortOrLongPressOnce(), as in In C.
+// Results are printed on the serial monitor (9600 baud), in CPU cycles per
+// loop, measured with Timer1 at full clock. Interrupts stay enabled, so the
+// figures include the ButtonBank tick and the millis() interrupt.
+//
+// ===========================================================================
+
+const byte BUTTONS[] { 3, 4, 5, 6, 7, 8, A0 };
+const unsigned int DEBOUNCE_DELAY = 50;
+const unsigned long LONG_PRESS_MS = 500;
+const unsigned int LOOPS = 10000;
+
+#include "lib/Button.cpp"
+#include "lib/ButtonBank.cpp"
+
+const byte N = sizeof(BUTTONS) / sizeof(BUTTONS[0]);
+
+Button button[N];
+byte bank[N];
+volatile byte sink; // Keeps the readings from being optimized away
+
+void setup() {
+	
+	Serial.begin(9600);
+	Serial.println(F("BUTTONS BENCHMARK"));
+	
+	for (byte i = 0; i < N; i++) {
+		button[i].init(BUTTONS[i], DEBOUNCE_DELAY, true, true);
+		bank[i] = ButtonBank::add(BUTTONS[i], true, true);
+	}
+	ButtonBank::start(DEBOUNCE_DELAY);
+	
+	// Timer1 as a free-running cycle counter
+	TCCR1A = 0;
+	TCCR1B = _BV(CS10);
+	TIMSK1 = 0;
+	
+}
+
+void loop() {
+	
+	unsigned long cycles = 0;
+	for (unsigned int l = 0; l < LOOPS; l++) {
+		unsigned int start = TCNT1;
+		for (byte i = 0; i < N; i++) sink = button[i].readShortOrLongPressOnce(LONG_PRESS_MS);
+		cycles += (unsigned int)(TCNT1 - start);
+	}
+	Serial.print(F("Button: "));
+	Serial.print(cycles / LOOPS);
+	
+	cycles = 0;
+	for (unsigned int l = 0; l < LOOPS; l++) {
+		unsigned int start = TCNT1;
+		for (byte i = 0; i < N; i++) sink = ButtonBank::readShortOrLongPressOnce(bank[i], LONG_PRESS_MS);
+		cycles += (unsigned int)(TCNT1 - start);
+	}
+	Serial.print(F(" cycles/loop, ButtonBank: "));
+	Serial.print(cycles / LOOPS);
+	
+	cycles = 0;
+	for (unsigned int l = 0; l < LOOPS; l++) {
+		unsigned int start = TCNT1;
+		sink = ButtonBank::readPresses();
+		cycles += (unsigned int)(TCNT1 - start);
+	}
+	Serial.print(F(" cycles/loop, ButtonBank bitmask: "));
+	Serial.print(cycles / LOOPS);
+	Serial.println(F(" cycles/loop"));
+	
+	delay(1000);
+	
+}
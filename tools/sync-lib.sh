@@ -0,0 +1,39 @@
+#!/bin/sh
+
+# SYNC LIBRARIES =============================================================
+#
+# The Arduino IDE builds a sketch from its own folder only, so each module
+# keeps a copy of the libraries it uses in its lib/ folder. The originals
+# are in the lib/ folder of the repository: edit them there, then run this
+# script to update every copy.
+#
+# Usage: tools/sync-lib.sh [--check]
+# With --check nothing is written, copies that differ are listed and the
+# exit status is 1 if there are any.
+#
+# ============================================================================
+
+cd "$(dirname "$0")/.." || exit 1
+
+check=0
+[ "$1" = "--check" ] && check=1
+
+status=0
+for copy in */lib/*.cpp */*/lib/*.cpp; do
+	[ -f "$copy" ] || continue
+	original="lib/$(basename "$copy")"
+	if [ ! -f "$original" ]; then
+		echo "No original for $copy"
+		status=1
+	elif ! cmp -s "$original" "$copy"; then
+		if [ $check -eq 1 ]; then
+			echo "Differs: $copy"
+			status=1
+		else
+			cp "$original" "$copy"
+			echo "Updated: $copy"
+		fi
+	fi
+done
+
+exit $status